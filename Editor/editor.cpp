@@ -32,17 +32,23 @@ struct Editor_State
 static Editor_State editor_state;
 
 void draw_graphics_window();
+static void draw_memory_stats();
 
 static void set_scene(Asset_Handle scene_asset)
 {
     HE_ASSERT(is_asset_of_type(scene_asset, HE_STRING_LITERAL("scene")));
     release_asset(editor_state.scene_asset);
+    evict_unreferenced_assets();
+    renderer_trim_resource_pools();
     acquire_asset(scene_asset);
     editor_state.scene_asset = scene_asset;
 }
 
 bool hope_app_init(Engine *engine)
 {
+    Memory_Tag previous_memory_tag = set_thread_memory_tag(Memory_Tag::EDITOR);
+    HE_DEFER { set_thread_memory_tag(previous_memory_tag); };
+
     Memory_Context memory_context = grab_memory_context();
 
     Editor_State *state = &editor_state;
@@ -327,6 +333,7 @@ void hope_app_on_update(Engine *engine, F32 delta_time)
             ImGui::Begin("Stats");
             ImGui::Text("frame time: %f ms", io.DeltaTime * 1000.0f);
             ImGui::Text("FPS: %u", (U32)io.Framerate);
+            draw_memory_stats();
             ImGui::End();
         }
 
@@ -384,6 +391,72 @@ void hope_app_shutdown(Engine *engine)
     }
 }
 
+static void draw_memory_stats_row(const char *name, const Memory_Stats &stats, U64 committed)
+{
+    F64 mega_byte = (F64)HE_MEGA_BYTES(1);
+
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::Text("%s", name);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f MB", stats.live_bytes / mega_byte);
+    ImGui::TableNextColumn();
+    ImGui::Text("%llu", stats.allocation_count);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f MB", stats.peak_bytes / mega_byte);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f KB", stats.frame_allocated_bytes / (F64)HE_KILO_BYTES(1));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f MB", committed / mega_byte);
+}
+
+static void draw_memory_stats()
+{
+    if (!ImGui::CollapsingHeader("Memory"))
+    {
+        return;
+    }
+
+    static Memory_Snapshot memory_snapshot;
+    take_memory_snapshot(&memory_snapshot);
+
+    ImGuiTableFlags table_flags = ImGuiTableFlags_Borders|ImGuiTableFlags_RowBg|ImGuiTableFlags_SizingFixedFit;
+    const char *columns[] = { "Name", "Live", "Allocations", "Peak", "Last Frame", "Committed" };
+
+    if (ImGui::BeginTable("##MemoryTags", HE_ARRAYCOUNT(columns), table_flags))
+    {
+        for (U32 column_index = 0; column_index < HE_ARRAYCOUNT(columns); column_index++)
+        {
+            ImGui::TableSetupColumn(columns[column_index]);
+        }
+        ImGui::TableHeadersRow();
+
+        for (U32 tag_index = 0; tag_index < (U32)Memory_Tag::COUNT; tag_index++)
+        {
+            draw_memory_stats_row(memory_tag_to_string((Memory_Tag)tag_index), memory_snapshot.tags[tag_index], 0);
+        }
+
+        ImGui::EndTable();
+    }
+
+    if (ImGui::BeginTable("##MemoryAllocators", HE_ARRAYCOUNT(columns), table_flags))
+    {
+        for (U32 column_index = 0; column_index < HE_ARRAYCOUNT(columns); column_index++)
+        {
+            ImGui::TableSetupColumn(columns[column_index]);
+        }
+        ImGui::TableHeadersRow();
+
+        for (U32 allocator_index = 0; allocator_index < memory_snapshot.allocator_count; allocator_index++)
+        {
+            const Memory_Allocator_Snapshot &allocator = memory_snapshot.allocators[allocator_index];
+            draw_memory_stats_row(allocator.name, allocator.stats, allocator.committed);
+        }
+
+        ImGui::EndTable();
+    }
+}
+
 static void draw_graphics_window()
 {
     Render_Context render_context = get_render_context();
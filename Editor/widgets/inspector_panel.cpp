@@ -153,8 +153,8 @@ static void internal_inspect_scene_node(Scene_Node *scene_node)
             String new_name = HE_STRING(inspector_state.rename_node_buffer);
             if (scene_node->name.data && new_name.count)
             {
-                HE_ALLOCATOR_DEALLOCATE(memory_context.general_allocator, (void *)scene_node->name.data);
-                scene_node->name = copy_string(new_name, memory_context.general_allocator);
+                HE_ALLOCATOR_DEALLOCATE(memory_context.slab_allocator, (void *)scene_node->name.data);
+                scene_node->name = copy_string(new_name, memory_context.slab_allocator);
             }
         }
     }
@@ -696,7 +696,7 @@ static void inspect_material(Asset_Handle material_asset)
 
             if (property_changed)
             {
-                set_property(material_handle, property->name, data);
+                set_property(material_handle, (S32)i, data);
             }
 
             ImGui::PopID();
@@ -362,8 +362,8 @@ static void draw_scene_node(Asset_Handle scene_asset, Scene_Handle scene_handle,
                 Scene_Node *node = get_node(scene, node_index);
                 if (node->name.data && new_name.count)
                 {
-                    HE_ALLOCATOR_DEALLOCATE(memory_context.general_allocator, (void *)node->name.data);
-                    node->name = copy_string(new_name, memory_context.general_allocator);
+                    HE_ALLOCATOR_DEALLOCATE(memory_context.slab_allocator, (void *)node->name.data);
+                    node->name = copy_string(new_name, memory_context.slab_allocator);
                 }
             }
         }
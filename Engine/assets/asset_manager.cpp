@@ -4,8 +4,11 @@
 #include "core/file_system.h"
 #include "core/job_system.h"
 #include "core/binary_stream.h"
+#include "core/cvars.h"
 
 #include "containers/dynamic_array.h"
+#include "containers/hash_map.h"
+#include "containers/queue.h"
 #include "containers/string.h"
 
 #include "assets/texture_importer.h"
@@ -15,8 +18,7 @@
 #include "assets/skybox_importer.h"
 #include "assets/scene_importer.h"
 
-#include <ExcaliburHash/ExcaliburHash.h>
-
+#include <algorithm>
 #include <random> // todo(amer): to be removed
 static U64 generate_uuid()
 {
@@ -32,19 +34,17 @@ struct Asset
     Load_Asset_Result load_result;
 };
 
-using Asset_Registry = Excalibur::HashMap< U64, Asset_Registry_Entry >;
-using Asset_Cache = Excalibur::HashMap< U64, Asset >;
-using Embeded_Asset_Cache = Excalibur::HashMap< U64, Dynamic_Array<U64> >;
-using Asset_Dependency = Excalibur::HashMap< U64, Dynamic_Array<U64> >;
+using Asset_Registry = Hash_Map< U64, Asset_Registry_Entry >;
+using Asset_Path_Index = Hash_Map< String, U64 >; // keys are the path strings owned by the registry entries.
+using Asset_Cache = Hash_Map< U64, Asset >;
+using Embeded_Asset_Cache = Hash_Map< U64, Dynamic_Array<U64> >;
+using Asset_Dependency = Hash_Map< U64, Dynamic_Array<U64> >;
 
 #define HE_ASSET_REGISTRY_FILE_NAME "asset_registry.haregistry"
+#define HE_MAX_PENDING_RELOAD_ASSET_COUNT 1024
 
-struct Load_Asset_Job_Data
-{
-    Asset_Handle asset_handle;
-};
-
-Job_Result load_asset_job(const Job_Parameters &params);
+static bool load_asset(Asset_Handle asset_handle);
+static void on_asset_memory_pressure(Memory_Tag memory_tag, U64 live_bytes, U64 target_bytes, void *user_data);
 bool serialize_asset_registry();
 bool deserialize_asset_registry();
 
@@ -56,10 +56,20 @@ struct Asset_Manager
 
     String asset_registry_path;
     Asset_Registry asset_registry;
+    Asset_Path_Index asset_path_index;
     Asset_Cache asset_cache;
     Embeded_Asset_Cache embeded_cache;
     Asset_Dependency asset_dependency;
-    Dynamic_Array<Asset_Handle> pending_reload_assets;
+    MPMC_Queue< Asset_Handle > pending_reload_assets; // pushed from the file watcher and drained by reload_assets.
+
+    // loaded assets with no references left, kept resident until their memory tag is under pressure, least recently released first.
+    Dynamic_Array<Asset_Handle> unreferenced_assets;
+
+    U32 texture_soft_budget_mb;
+    U32 texture_hard_budget_mb;
+    U32 mesh_soft_budget_mb;
+    U32 mesh_hard_budget_mb;
+
     Mutex asset_mutex;
 };
 
@@ -86,9 +96,9 @@ static Job_Result reload_asset_job(const Job_Parameters &params)
     Asset_Registry_Entry &entry = internal_get_asset_registry_entry(asset_handle);
     
     const Asset_Info *info = get_asset_info(entry.type_info_index);
-    auto cache_it = asset_manager_state->asset_cache.find(asset_handle.uuid);
-    HE_ASSERT(cache_it != asset_manager_state->asset_cache.iend());
-    Asset &asset = cache_it.value();
+    auto cache_it = find(&asset_manager_state->asset_cache, asset_handle.uuid);
+    HE_ASSERT(is_valid(cache_it));
+    Asset &asset = *cache_it.value;
 
     String relative_path = entry.path;
     load_asset_proc load = info->load;
@@ -114,7 +124,10 @@ static Job_Result reload_asset_job(const Job_Parameters &params)
         .data_id = data_id,
     };
 
+    Memory_Tag previous_memory_tag = set_thread_memory_tag(info->memory_tag);
     Load_Asset_Result load_result = load(path, is_embeded ? &embeded_params : nullptr);
+    set_thread_memory_tag(previous_memory_tag);
+
     if (!load_result.success)
     {
         entry.state = Asset_State::FAILED_TO_LOAD;
@@ -172,17 +185,15 @@ static void internal_reload_asset(Asset_Handle asset_handle, Job_Handle parent_j
     }
 
     const Asset_Info *info = get_asset_info(entry.type_info_index);
-    auto cache_it = asset_manager_state->asset_cache.find(asset_handle.uuid);
+    auto cache_it = find(&asset_manager_state->asset_cache, asset_handle.uuid);
 
-    Asset *asset = nullptr;
+    Asset *asset = cache_it.value;
 
-    if (cache_it == asset_manager_state->asset_cache.iend())
+    if (!is_valid(cache_it))
     {
-        cache_it = asset_manager_state->asset_cache.emplace(asset_handle.uuid, Asset {}).first;
+        asset = insert(&asset_manager_state->asset_cache, asset_handle.uuid);
     }
 
-    asset = &cache_it.value();
-
     if (entry.state == Asset_State::LOADED)
     {
         info->unload(asset->load_result);
@@ -205,16 +216,18 @@ static void internal_reload_asset(Asset_Handle asset_handle, Job_Handle parent_j
             .size = sizeof(Reload_Asset_Job_Data),
             .alignment = alignof(Reload_Asset_Job_Data)
         },
-        .proc = &reload_asset_job
+        .proc = &reload_asset_job,
+        .priority = Job_Priority::BACKGROUND,
+        .name = "reload_asset"
     };
 
     Job_Handle wait_for_jobs[] = { entry.job, parent_job }; 
     entry.job = execute_job(job_data, to_array_view(wait_for_jobs));
 
-    auto dependency_it = asset_manager_state->asset_dependency.find(asset_handle.uuid);
-    if (dependency_it != asset_manager_state->asset_dependency.iend())
+    auto dependency_it = find(&asset_manager_state->asset_dependency, asset_handle.uuid);
+    if (is_valid(dependency_it))
     {
-        Dynamic_Array< U64 > &children = dependency_it.value();
+        Dynamic_Array< U64 > &children = *dependency_it.value;
         for (U32 i = 0; i < children.count; i++)
         {
             Asset_Handle child_asset_handle = { .uuid = children[i] };
@@ -270,8 +283,10 @@ static void on_file_changes(Watch_Directory_Result result, String old_path, Stri
 
             Asset_Registry_Entry &entry = internal_get_asset_registry_entry(asset_handle);
 
+            remove(&asset_manager_state->asset_path_index, entry.path);
             HE_ALLOCATOR_DEALLOCATE(memory_context.general_allocator, (void *)entry.path.data);
             entry.path = copy_string(new_path, memory_context.general_allocator);
+            insert(&asset_manager_state->asset_path_index, entry.path, asset_handle.uuid);
             HE_LOG(Assets, Trace, "[Rename]: %.*s to %.*s \n", HE_EXPAND_STRING(old_path), HE_EXPAND_STRING(new_path));
             
             serialize_asset_registry();
@@ -281,7 +296,11 @@ static void on_file_changes(Watch_Directory_Result result, String old_path, Stri
         {
             HE_LOG(Assets, Trace, "[Modified]: %.*s\n", HE_EXPAND_STRING(old_path));
             Asset_Handle asset_handle = get_asset_handle(old_path);
-            append(&asset_manager_state->pending_reload_assets, asset_handle);
+            // reloads right away when the queue is full so the change isn't lost.
+            if (!push(&asset_manager_state->pending_reload_assets, asset_handle))
+            {
+                reload_asset(asset_handle);
+            }
         } break;
 
         case FILE_DELETED:
@@ -305,6 +324,18 @@ static void on_file_changes(Watch_Directory_Result result, String old_path, Stri
     }
 }
 
+// the budget cvars can change at runtime so they are applied again every frame.
+static void apply_memory_budgets()
+{
+    U32 texture_soft_budget_mb = asset_manager_state->texture_soft_budget_mb;
+    U32 texture_hard_budget_mb = HE_MAX(asset_manager_state->texture_hard_budget_mb, texture_soft_budget_mb);
+    set_memory_budget(Memory_Tag::TEXTURES, HE_MEGA_BYTES(texture_soft_budget_mb), HE_MEGA_BYTES(texture_hard_budget_mb));
+
+    U32 mesh_soft_budget_mb = asset_manager_state->mesh_soft_budget_mb;
+    U32 mesh_hard_budget_mb = HE_MAX(asset_manager_state->mesh_hard_budget_mb, mesh_soft_budget_mb);
+    set_memory_budget(Memory_Tag::MESHES, HE_MEGA_BYTES(mesh_soft_budget_mb), HE_MEGA_BYTES(mesh_hard_budget_mb));
+}
+
 bool init_asset_manager(String asset_path)
 {
     if (asset_manager_state)
@@ -323,13 +354,33 @@ bool init_asset_manager(String asset_path)
     asset_manager_state = HE_ALLOCATOR_ALLOCATE(memory_context.permenent_allocator, Asset_Manager);
     asset_manager_state->asset_path = copy_string(asset_path, memory_context.permenent_allocator);
 
-    asset_manager_state->asset_registry = Asset_Registry();
-    asset_manager_state->asset_cache = Asset_Cache();
-    asset_manager_state->embeded_cache = Embeded_Asset_Cache();
-    asset_manager_state->asset_dependency = Asset_Dependency();
+    init(&asset_manager_state->asset_registry);
+    init(&asset_manager_state->asset_path_index);
+    init(&asset_manager_state->asset_cache);
+    init(&asset_manager_state->embeded_cache);
+    init(&asset_manager_state->asset_dependency);
+    init(&asset_manager_state->pending_reload_assets, HE_MAX_PENDING_RELOAD_ASSET_COUNT, memory_context.permenent_allocator);
 
     platform_create_mutex(&asset_manager_state->asset_mutex);
 
+    U32 &texture_soft_budget_mb = asset_manager_state->texture_soft_budget_mb;
+    U32 &texture_hard_budget_mb = asset_manager_state->texture_hard_budget_mb;
+    U32 &mesh_soft_budget_mb = asset_manager_state->mesh_soft_budget_mb;
+    U32 &mesh_hard_budget_mb = asset_manager_state->mesh_hard_budget_mb;
+
+    // default settings
+    texture_soft_budget_mb = 1024;
+    texture_hard_budget_mb = 2048;
+    mesh_soft_budget_mb = 512;
+    mesh_hard_budget_mb = 1024;
+
+    HE_DECLARE_CVAR("assets", texture_soft_budget_mb, CVarFlag_None);
+    HE_DECLARE_CVAR("assets", texture_hard_budget_mb, CVarFlag_None);
+    HE_DECLARE_CVAR("assets", mesh_soft_budget_mb, CVarFlag_None);
+    HE_DECLARE_CVAR("assets", mesh_hard_budget_mb, CVarFlag_None);
+
+    apply_memory_budgets();
+
     {
         String extensions[] =
         {
@@ -340,7 +391,7 @@ bool init_asset_manager(String asset_path)
             HE_STRING_LITERAL("psd"),
         };
 
-        register_asset(HE_STRING_LITERAL("texture"), to_array_view(extensions), &load_texture, &unload_texture);
+        register_asset(HE_STRING_LITERAL("texture"), to_array_view(extensions), &load_texture, &unload_texture, nullptr, Memory_Tag::TEXTURES);
     }
 
     {
@@ -349,7 +400,7 @@ bool init_asset_manager(String asset_path)
             HE_STRING_LITERAL("hdr"),
         };
 
-        register_asset(HE_STRING_LITERAL("environment_map"), to_array_view(extensions), &load_environment_map, &unload_environment_map);
+        register_asset(HE_STRING_LITERAL("environment_map"), to_array_view(extensions), &load_environment_map, &unload_environment_map, nullptr, Memory_Tag::TEXTURES);
     }
 
     {
@@ -357,7 +408,7 @@ bool init_asset_manager(String asset_path)
         {
             HE_STRING_LITERAL("glsl"),
         };
-        register_asset(HE_STRING_LITERAL("shader"), to_array_view(extensions), &load_shader, &unload_shader);
+        register_asset(HE_STRING_LITERAL("shader"), to_array_view(extensions), &load_shader, &unload_shader, nullptr, Memory_Tag::SHADERS);
     }
 
     {
@@ -365,7 +416,7 @@ bool init_asset_manager(String asset_path)
         {
             HE_STRING_LITERAL("hamaterial"),
         };
-        register_asset(HE_STRING_LITERAL("material"), to_array_view(extensions), &load_material, &unload_material);
+        register_asset(HE_STRING_LITERAL("material"), to_array_view(extensions), &load_material, &unload_material, nullptr, Memory_Tag::MATERIALS);
     }
 
     {
@@ -373,7 +424,7 @@ bool init_asset_manager(String asset_path)
         {
             HE_STRING_LITERAL("hastaticmesh"),
         };
-        register_asset(HE_STRING_LITERAL("static_mesh"), to_array_view(extensions), &load_static_mesh, &unload_static_mesh);
+        register_asset(HE_STRING_LITERAL("static_mesh"), to_array_view(extensions), &load_static_mesh, &unload_static_mesh, nullptr, Memory_Tag::MESHES);
     }
 
     {
@@ -383,7 +434,7 @@ bool init_asset_manager(String asset_path)
             HE_STRING_LITERAL("glb")
         };
 
-        register_asset(HE_STRING_LITERAL("model"), to_array_view(extensions), &load_model, &unload_model, &on_import_model);
+        register_asset(HE_STRING_LITERAL("model"), to_array_view(extensions), &load_model, &unload_model, &on_import_model, Memory_Tag::MESHES);
     }
 
     {
@@ -401,7 +452,7 @@ bool init_asset_manager(String asset_path)
             HE_STRING_LITERAL("hascene")
         };
 
-        register_asset(HE_STRING_LITERAL("scene"), to_array_view(extensions), &load_scene, &unload_scene);
+        register_asset(HE_STRING_LITERAL("scene"), to_array_view(extensions), &load_scene, &unload_scene, nullptr, Memory_Tag::SCENES);
     }
 
     String asset_registry_path = format_string(memory_context.temp_allocator, "%.*s/%s", HE_EXPAND_STRING(asset_manager_state->asset_path), HE_ASSET_REGISTRY_FILE_NAME);
@@ -440,13 +491,13 @@ void deinit_asset_manager()
 
 void reload_assets()
 {
-    for (U32 i = 0; i < asset_manager_state->pending_reload_assets.count; i++)
+    apply_memory_budgets();
+
+    Asset_Handle asset_handle;
+    while (pop(&asset_manager_state->pending_reload_assets, &asset_handle))
     {
-        Asset_Handle asset_handle = asset_manager_state->pending_reload_assets[i];
         reload_asset(asset_handle);
     }
-
-    reset(&asset_manager_state->pending_reload_assets);
 }
 
 String get_asset_path()
@@ -454,7 +505,7 @@ String get_asset_path()
     return asset_manager_state->asset_path;
 }
 
-bool register_asset(String name, Array_View< String > extensions, load_asset_proc load, unload_asset_proc unload, on_import_asset_proc on_import)
+bool register_asset(String name, Array_View< String > extensions, load_asset_proc load, unload_asset_proc unload, on_import_asset_proc on_import, Memory_Tag memory_tag)
 {
     for (U32 i = 0; i < asset_manager_state->asset_infos.count; i++)
     {
@@ -482,14 +533,18 @@ bool register_asset(String name, Array_View< String > extensions, load_asset_pro
     asset_info.on_import = on_import;
     asset_info.load = load;
     asset_info.unload = unload;
+    asset_info.memory_tag = memory_tag;
+
+    bool callback_registered = register_memory_pressure_callback(memory_tag, &on_asset_memory_pressure);
+    HE_ASSERT(callback_registered);
 
     return true;
 }
 
 static bool internal_is_asset_handle_valid(Asset_Handle asset_handle)
 {
-    auto it = asset_manager_state->asset_registry.find(asset_handle.uuid);
-    return it != asset_manager_state->asset_registry.iend() && !it.value().is_deleted;
+    auto it = find(&asset_manager_state->asset_registry, asset_handle.uuid);
+    return is_valid(it) && !it.value->is_deleted;
 }
 
 bool is_asset_handle_valid(Asset_Handle asset_handle)
@@ -513,8 +568,8 @@ bool is_asset_of_type(Asset_Handle asset_handle, String type)
 
 static bool internal_is_asset_loaded(Asset_Handle asset_handle)
 {
-    auto it = asset_manager_state->asset_cache.find(asset_handle.uuid);
-    return it != asset_manager_state->asset_cache.iend() && it.value().load_result.success;
+    auto it = find(&asset_manager_state->asset_cache, asset_handle.uuid);
+    return is_valid(it) && it.value->load_result.success;
 }
 
 bool is_asset_loaded(Asset_Handle asset_handle)
@@ -524,15 +579,52 @@ bool is_asset_loaded(Asset_Handle asset_handle)
     return internal_is_asset_loaded(asset_handle);
 }
 
+static Job_Coroutine load_asset_coroutine(Asset_Handle asset_handle, Asset_Handle parent_asset, Job_Handle parent_job)
+{
+    // always continues on a background thread, the acquiring thread is holding the asset mutex.
+    co_await resume_after_job(parent_job, Job_Priority::BACKGROUND, "load_asset");
+
+    if (is_asset_handle_valid(parent_asset) && !is_asset_loaded(parent_asset))
+    {
+        platform_lock_mutex(&asset_manager_state->asset_mutex);
+        HE_DEFER { platform_unlock_mutex(&asset_manager_state->asset_mutex); };
+
+        Asset_Registry_Entry &entry = internal_get_asset_registry_entry(asset_handle);
+        entry.state = Asset_State::FAILED_TO_LOAD;
+        HE_LOG(Assets, Error, "load_asset -- failed to load asset: %.*s --> parent asset failed to load\n", HE_EXPAND_STRING(entry.path));
+        co_return Job_Result::FAILED;
+    }
+
+    // makes room by evicting unreferenced assets before loading on top of a full budget.
+    Memory_Tag memory_tag = get_asset_info(asset_handle)->memory_tag;
+    if (!reclaim_memory(memory_tag, 0))
+    {
+        HE_LOG(Assets, Warn, "load_asset -- %s memory is over its hard budget\n", memory_tag_to_string(memory_tag));
+    }
+
+    bool loaded = load_asset(asset_handle);
+    co_return loaded ? Job_Result::SUCCEEDED : Job_Result::FAILED;
+}
+
 static Job_Handle internal_acquire_asset(Asset_Handle asset_handle)
 {
     Asset_Registry &asset_registry = asset_manager_state->asset_registry;
 
-    auto entry_it = asset_registry.find(asset_handle.uuid);
-    HE_ASSERT(entry_it != asset_registry.iend());
-    Asset_Registry_Entry &entry = entry_it.value();
+    auto entry_it = find(&asset_registry, asset_handle.uuid);
+    HE_ASSERT(is_valid(entry_it));
+    Asset_Registry_Entry &entry = *entry_it.value;
     entry.ref_count++;
 
+    if (entry.ref_count == 1 && entry.state == Asset_State::LOADED)
+    {
+        Dynamic_Array< Asset_Handle > &unreferenced_assets = asset_manager_state->unreferenced_assets;
+        S32 index = find(&unreferenced_assets, asset_handle);
+        if (index != -1)
+        {
+            remove_ordered(&unreferenced_assets, index);
+        }
+    }
+
     if (entry.state == Asset_State::UNLOADED)
     {
         entry.state = Asset_State::PENDING;
@@ -543,26 +635,7 @@ static Job_Handle internal_acquire_asset(Asset_Handle asset_handle)
             parent_job = internal_acquire_asset(entry.parent);
         }
 
-        String path = entry.path;
-        const Asset_Info *asset_info = &asset_manager_state->asset_infos[entry.type_info_index];
-
-        Load_Asset_Job_Data load_asset_job_data =
-        {
-            .asset_handle = asset_handle,
-        };
-
-        Job_Data data =
-        {
-            .parameters =
-            {
-                .data = &load_asset_job_data,
-                .size = sizeof(Load_Asset_Job_Data),
-                .alignment = alignof(Load_Asset_Job_Data)
-            },
-            .proc = &load_asset_job
-        };
-
-        entry.job = execute_job(data, { .count = 1, .data = &parent_job });
+        entry.job = load_asset_coroutine(asset_handle, entry.parent, parent_job).job_handle;
     }
 
     return entry.job;
@@ -581,12 +654,57 @@ Load_Asset_Result get_asset(Asset_Handle asset_handle)
     HE_DEFER { platform_unlock_mutex(&asset_manager_state->asset_mutex); };
 
     Asset_Cache &asset_cache = asset_manager_state->asset_cache;
-    auto it = asset_cache.find(asset_handle.uuid);
-    HE_ASSERT(it != asset_cache.iend());
-    Asset* asset = &it.value();
+    auto it = find(&asset_cache, asset_handle.uuid);
+    HE_ASSERT(is_valid(it));
+    Asset* asset = it.value;
     return asset->load_result;
 }
 
+static void internal_unload_asset(Asset_Handle asset_handle, Asset_Registry_Entry &entry)
+{
+    Asset_Info &info = asset_manager_state->asset_infos[entry.type_info_index];
+    HE_ASSERT(info.unload);
+
+    Asset_Cache &asset_cache = asset_manager_state->asset_cache;
+    auto it = find(&asset_cache, asset_handle.uuid);
+    if (is_valid(it))
+    {
+        Asset *asset = it.value;
+        info.unload(asset->load_result);
+        remove(&asset_cache, asset_handle.uuid);
+    }
+    entry.state = Asset_State::UNLOADED;
+    HE_LOG(Assets, Trace, "unloaded asset: %.*s\n", HE_EXPAND_STRING(entry.path));
+}
+
+// evicts unreferenced assets of the tag least recently released first, unloading an asset can release and append others.
+static void on_asset_memory_pressure(Memory_Tag memory_tag, U64 live_bytes, U64 target_bytes, void *user_data)
+{
+    (void)live_bytes;
+    (void)user_data;
+
+    platform_lock_mutex(&asset_manager_state->asset_mutex);
+    HE_DEFER { platform_unlock_mutex(&asset_manager_state->asset_mutex); };
+
+    Dynamic_Array< Asset_Handle > &unreferenced_assets = asset_manager_state->unreferenced_assets;
+
+    U32 index = 0;
+    while (index < unreferenced_assets.count && get_memory_tag_live_bytes(memory_tag) > target_bytes)
+    {
+        Asset_Handle asset_handle = unreferenced_assets[index];
+        Asset_Registry_Entry &entry = internal_get_asset_registry_entry(asset_handle);
+        if (asset_manager_state->asset_infos[entry.type_info_index].memory_tag != memory_tag)
+        {
+            index++;
+            continue;
+        }
+
+        remove_ordered(&unreferenced_assets, index);
+        HE_ASSERT(entry.ref_count == 0);
+        internal_unload_asset(asset_handle, entry);
+    }
+}
+
 void release_asset(Asset_Handle asset_handle)
 {
     platform_lock_mutex(&asset_manager_state->asset_mutex);
@@ -594,48 +712,68 @@ void release_asset(Asset_Handle asset_handle)
 
     Asset_Registry &asset_registry = asset_manager_state->asset_registry;
 
-    auto entry_it = asset_registry.find(asset_handle.uuid);
-    if (entry_it == asset_registry.iend())
+    auto entry_it = find(&asset_registry, asset_handle.uuid);
+    if (!is_valid(entry_it))
     {
         return;
     }
 
-    Asset_Registry_Entry &entry = entry_it.value();
+    Asset_Registry_Entry &entry = *entry_it.value;
 
     
     HE_ASSERT(entry.ref_count);
     entry.ref_count--;
 
-    if (entry.ref_count == 0)
+    if (entry.ref_count)
     {
-        Asset_Info &info = asset_manager_state->asset_infos[entry.type_info_index];
-        HE_ASSERT(info.unload);
+        return;
+    }
 
-        Asset_Cache &asset_cache = asset_manager_state->asset_cache;
-        auto it = asset_cache.find(asset_handle.uuid);
-        if (it != asset_cache.iend())
-        {
-            Asset *asset = &it.value();
-            info.unload(asset->load_result);
-            asset_cache.erase(it);
-        }
-        entry.state = Asset_State::UNLOADED;
-        HE_LOG(Assets, Trace, "unloaded asset: %.*s\n", HE_EXPAND_STRING(entry.path));
+    // assets of a tag with room left in its budget stay resident so acquiring them again is free.
+    Memory_Tag memory_tag = asset_manager_state->asset_infos[entry.type_info_index].memory_tag;
+    if (entry.state == Asset_State::LOADED && get_memory_budget(memory_tag).soft_budget && get_memory_pressure(memory_tag) == Memory_Pressure::NONE)
+    {
+        append(&asset_manager_state->unreferenced_assets, asset_handle);
+        return;
+    }
+
+    internal_unload_asset(asset_handle, entry);
+}
+
+void evict_unreferenced_assets()
+{
+    platform_lock_mutex(&asset_manager_state->asset_mutex);
+    HE_DEFER { platform_unlock_mutex(&asset_manager_state->asset_mutex); };
+
+    Dynamic_Array< Asset_Handle > &unreferenced_assets = asset_manager_state->unreferenced_assets;
+
+    // unloading an asset can release and append others so this runs until the array stays empty.
+    while (unreferenced_assets.count)
+    {
+        Asset_Handle asset_handle = unreferenced_assets[0];
+        Asset_Registry_Entry &entry = internal_get_asset_registry_entry(asset_handle);
+
+        remove_ordered(&unreferenced_assets, 0);
+        HE_ASSERT(entry.ref_count == 0);
+        internal_unload_asset(asset_handle, entry);
     }
 }
 
 static Asset_Handle internal_get_asset_handle(String path)
 {
-    for (auto it = asset_manager_state->asset_registry.ibegin(); it != asset_manager_state->asset_registry.iend(); it++)
+    auto it = find(&asset_manager_state->asset_path_index, path);
+    if (!is_valid(it))
     {
-        const Asset_Registry_Entry &entry = it.value();
-        if (entry.path == path && !entry.is_deleted)
-        {
-            return { .uuid = it.key() };
-        }
+        return { .uuid = 0 };
     }
 
-    return { .uuid = 0 };
+    Asset_Handle asset_handle = { .uuid = *it.value };
+    if (internal_get_asset_registry_entry(asset_handle).is_deleted)
+    {
+        return { .uuid = 0 };
+    }
+
+    return asset_handle;
 }
 
 Asset_Handle get_asset_handle(String path)
@@ -649,16 +787,16 @@ static void internal_add_embeded_asset(Asset_Handle embeder_asset_handle, Asset_
 {
     auto &embeded_cache = asset_manager_state->embeded_cache;
     
-    auto it = embeded_cache.find(embeder_asset_handle.uuid);
-    if (it == embeded_cache.iend())
+    auto it = find(&embeded_cache, embeder_asset_handle.uuid);
+    if (!is_valid(it))
     {
         Dynamic_Array<U64> embeded = {};
         append(&embeded, asset_handle.uuid);
-        embeded_cache.emplace(embeder_asset_handle.uuid, embeded);
+        insert(&embeded_cache, embeder_asset_handle.uuid, embeded);
     }
     else
     {
-        Dynamic_Array<U64> &embeded = it.value();
+        Dynamic_Array<U64> &embeded = *it.value;
         if (find(&embeded, asset_handle.uuid) == -1)
         {
             append(&embeded, asset_handle.uuid);
@@ -670,16 +808,17 @@ static void internal_add_asset_dependency(Asset_Handle parent_handle, Asset_Hand
 {
     Asset_Dependency &dependency = asset_manager_state->asset_dependency;
     
-    auto it = dependency.find(parent_handle.uuid);
-    if (it == dependency.iend())
+    auto it = find(&dependency, parent_handle.uuid);
+    if (!is_valid(it))
     {
-        Dynamic_Array<U64> children = {};
+        Memory_Context memory_context = grab_memory_context();
+        Dynamic_Array<U64> children = make_dynamic_array<U64>(memory_context.slab_allocator);
         append(&children, asset_handle.uuid);
-        dependency.emplace(parent_handle.uuid, children);
+        insert(&dependency, parent_handle.uuid, children);
     }
     else
     {
-        Dynamic_Array<U64> &children = it.value();
+        Dynamic_Array<U64> &children = *it.value;
         if (find(&children, asset_handle.uuid) == -1)
         {
             append(&children, asset_handle.uuid);
@@ -704,29 +843,29 @@ Asset_Handle import_asset(String path)
     sanitize_path(path);
 
     auto &registry = asset_manager_state->asset_registry;
+    auto &path_index = asset_manager_state->asset_path_index;
 
+    auto path_it = find(&path_index, path);
+    if (is_valid(path_it))
+    {
+        Asset_Handle asset_handle = { .uuid = *path_it.value };
+        internal_get_asset_registry_entry(asset_handle).is_deleted = false;
+        return asset_handle;
+    }
+
+    // a deleted asset with the same file name was moved here, only new paths have to walk the registry.
     String name_with_extension = get_name_with_extension(path);
 
-    for (auto it = asset_manager_state->asset_registry.ibegin(); it != asset_manager_state->asset_registry.iend(); it++)
+    for (auto [uuid, entry] : registry)
     {
-        Asset_Registry_Entry &entry = it.value();
-        if (name_with_extension == get_name_with_extension(entry.path) && entry.is_deleted)
+        if (entry.is_deleted && name_with_extension == get_name_with_extension(entry.path))
         {
+            remove(&path_index, entry.path);
             HE_ALLOCATOR_DEALLOCATE(memory_context.general_allocator, (void *)entry.path.data);
             entry.path = copy_string(path, memory_context.general_allocator);
             entry.is_deleted = false;
-            return { .uuid = it.key() };
-        }
-        else if (path == entry.path)
-        {
-            if (entry.is_deleted)
-            {
-                return {};
-            }
-            else
-            {
-                return { .uuid = it.key() };
-            }
+            insert(&path_index, entry.path, uuid);
+            return { .uuid = uuid };
         }
     }
 
@@ -775,7 +914,8 @@ Asset_Handle import_asset(String path)
     };
 
     Asset_Handle asset_handle = { .uuid = generate_uuid() };
-    registry.emplace(asset_handle.uuid, entry);
+    insert(&registry, asset_handle.uuid, entry);
+    insert(&path_index, entry.path, asset_handle.uuid);
 
     if (is_embeded && internal_is_asset_handle_valid(embeder))
     {   
@@ -799,16 +939,16 @@ void set_parent(Asset_Handle asset, Asset_Handle parent)
 
     Asset_Registry &registry = asset_manager_state->asset_registry;
     Asset_Dependency &dependency = asset_manager_state->asset_dependency;
-    auto it = registry.find(asset.uuid);
-    auto parent_it = registry.find(parent.uuid);
-    HE_ASSERT(it != registry.iend());
-    Asset_Registry_Entry &entry = it.value();
+    auto it = find(&registry, asset.uuid);
+    auto parent_it = find(&registry, parent.uuid);
+    HE_ASSERT(is_valid(it));
+    Asset_Registry_Entry &entry = *it.value;
     if (entry.parent.uuid != 0)
     {
-        auto dependency_it = dependency.find(entry.parent.uuid);
-        if (dependency_it != dependency.iend())
+        auto dependency_it = find(&dependency, entry.parent.uuid);
+        if (is_valid(dependency_it))
         {
-            Dynamic_Array< U64 > &children = dependency_it.value();
+            Dynamic_Array< U64 > &children = *dependency_it.value;
             S64 index = find(&children, asset.uuid);
             if (index != -1)
             {
@@ -817,12 +957,12 @@ void set_parent(Asset_Handle asset, Asset_Handle parent)
         }
     }
 
-    if (parent_it != registry.iend())
+    if (is_valid(parent_it))
     {
         internal_add_asset_dependency(parent, asset);
     }
 
-    if (parent.uuid == 0 || parent_it != registry.iend())
+    if (parent.uuid == 0 || is_valid(parent_it))
     {
         entry.parent = parent;
     }
@@ -859,19 +999,19 @@ bool is_asset_embeded(Asset_Handle asset_handle)
 
 Array_View< U64 > get_embeded_assets(Asset_Handle asset_handle)
 {
-    auto it = asset_manager_state->embeded_cache.find(asset_handle.uuid);
-    if (it == asset_manager_state->embeded_cache.iend())
+    auto it = find(&asset_manager_state->embeded_cache, asset_handle.uuid);
+    if (!is_valid(it))
     {
         return {};
     }
-    return to_array_view(it.value());
+    return to_array_view(*it.value);
 }
 
 static Asset_Registry_Entry& internal_get_asset_registry_entry(Asset_Handle asset_handle)
 {
-    auto it = asset_manager_state->asset_registry.find(asset_handle.uuid);
-    HE_ASSERT(it != asset_manager_state->asset_registry.iend());
-    return it.value();
+    auto it = find(&asset_manager_state->asset_registry, asset_handle.uuid);
+    HE_ASSERT(is_valid(it));
+    return *it.value;
 }
 
 const Asset_Registry_Entry& get_asset_registry_entry(Asset_Handle asset_handle)
@@ -912,9 +1052,9 @@ const Asset_Info *get_asset_info(U16 type_info_index)
 
 Load_Asset_Result *get_asset_load_result(Asset_Handle asset)
 {
-    auto it = asset_manager_state->asset_cache.find(asset.uuid);
-    HE_ASSERT(it != asset_manager_state->asset_cache.iend());
-    return &it.value().load_result;
+    auto it = find(&asset_manager_state->asset_cache, asset.uuid);
+    HE_ASSERT(is_valid(it));
+    return &it.value->load_result;
 }
 
 //
@@ -938,15 +1078,14 @@ const Asset_Info *get_asset_info_from_extension(String extension)
     return nullptr;
 }
 
-static Job_Result load_asset_job(const Job_Parameters &params)
+static bool load_asset(Asset_Handle asset_handle)
 {
-    Load_Asset_Job_Data *job_data = (Load_Asset_Job_Data *)params.data;
-
     Memory_Context memory_context = grab_memory_context();
 
-    const Asset_Registry_Entry &asset_entry = get_asset_registry_entry(job_data->asset_handle);
+    const Asset_Registry_Entry &asset_entry = get_asset_registry_entry(asset_handle);
     String relative_path = asset_entry.path;
     load_asset_proc load = asset_manager_state->asset_infos[asset_entry.type_info_index].load;
+    Memory_Tag memory_tag = asset_manager_state->asset_infos[asset_entry.type_info_index].memory_tag;
 
     Asset_Handle embedder_asset = {};
     U64 data_id = 0;
@@ -970,25 +1109,27 @@ static Job_Result load_asset_job(const Job_Parameters &params)
         .data_id = data_id,
     };
 
+    Memory_Tag previous_memory_tag = set_thread_memory_tag(memory_tag);
     Load_Asset_Result load_result = load(path, is_embeded ? &embeded_params : nullptr);
+    set_thread_memory_tag(previous_memory_tag);
 
     platform_lock_mutex(&asset_manager_state->asset_mutex);
     HE_DEFER { platform_unlock_mutex(&asset_manager_state->asset_mutex); };
     
-    Asset_Registry_Entry &entry = internal_get_asset_registry_entry(job_data->asset_handle);
+    Asset_Registry_Entry &entry = internal_get_asset_registry_entry(asset_handle);
         
     if (!load_result.success)
     {
         entry.state = Asset_State::FAILED_TO_LOAD;
-        HE_LOG(Assets, Error, "load_asset_job -- failed to load asset: %.*s\n", HE_EXPAND_STRING(asset_entry.path));
-        return Job_Result::FAILED;
+        HE_LOG(Assets, Error, "load_asset -- failed to load asset: %.*s\n", HE_EXPAND_STRING(asset_entry.path));
+        return false;
     }
     
     entry.state = Asset_State::LOADED;
-    asset_manager_state->asset_cache.emplace(job_data->asset_handle.uuid, Asset { .load_result = load_result });
+    insert(&asset_manager_state->asset_cache, asset_handle.uuid, Asset { .load_result = load_result });
     
     HE_LOG(Assets, Trace, "loaded asset: %.*s\n", HE_EXPAND_STRING(asset_entry.path));
-    return Job_Result::SUCCEEDED;
+    return true;
 
 }
 
@@ -1002,16 +1143,16 @@ static bool serialize_asset_registry()
     Asset_Registry &registry = asset_manager_state->asset_registry;
     Asset_Dependency &dependency = asset_manager_state->asset_dependency;
 
-    Asset_Handle *handles = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, Asset_Handle, registry.size());
+    Asset_Handle *handles = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, Asset_Handle, registry.count);
     
     {
         U32 handle_index = 0;
-        for (auto it = registry.ibegin(); it != registry.iend(); ++it)
+        for (auto [uuid, entry] : registry)
         {
-            handles[handle_index++] = { .uuid = it.key() };
+            handles[handle_index++] = { .uuid = uuid };
         }
 
-        std::sort(handles, handles + registry.size(), [&dependency](Asset_Handle a, Asset_Handle b)
+        std::sort(handles, handles + registry.count, [&dependency](Asset_Handle a, Asset_Handle b)
         {
             U32 a_count = 0;
             U32 b_count = 0;
@@ -1053,11 +1194,11 @@ static bool serialize_asset_registry()
     begin_string_builder(&builder, memory_context.temprary_memory.arena);
     
     append(&builder, "version 1\n");
-    append(&builder, "entry_count %u\n", registry.size());
+    append(&builder, "entry_count %u\n", registry.count);
 
-    for (U32 i = 0; i < registry.size(); i++)
+    for (U32 i = 0; i < registry.count; i++)
     {
-        const Asset_Registry_Entry &entry = registry[handles[i].uuid];
+        const Asset_Registry_Entry &entry = *find(&registry, handles[i].uuid).value;
         append(&builder, "\nasset %llu\n", handles[i].uuid);
         append(&builder, "parent %llu\n", entry.parent.uuid);
         append(&builder, "path %llu %.*s\n", entry.path.count, HE_EXPAND_STRING(entry.path));
@@ -1074,6 +1215,21 @@ static bool serialize_asset_registry()
     return success;
 }
 
+static void validate_asset_registry_entries(const Parallel_For_Parameters &params)
+{
+    Asset_Handle *asset_handles = (Asset_Handle *)params.data;
+
+    for (U32 i = params.begin; i < params.end; i++)
+    {
+        Asset_Registry_Entry &entry = internal_get_asset_registry_entry(asset_handles[i]);
+
+        Temprary_Memory temprary_memory = begin_temprary_memory(params.arena);
+        String absolute_path = internal_get_asset_absolute_path(entry, to_allocator(params.arena));
+        entry.is_deleted = !file_exists(absolute_path);
+        end_temprary_memory(temprary_memory);
+    }
+}
+
 static bool deserialize_asset_registry()
 {
     platform_lock_mutex(&asset_manager_state->asset_mutex);
@@ -1159,9 +1315,6 @@ static bool deserialize_asset_registry()
         const Asset_Info *asset_info = get_asset_info_from_extension(extension);
         HE_ASSERT(asset_info);
 
-        Asset_Handle asset_handle = { .uuid = asset_uuid };
-        Asset_Handle parent_handle = { .uuid = parent_uuid };
-
         Asset_Registry_Entry entry = {};
         entry.path = copy_string(path, memory_context.general_allocator);
         entry.type_info_index = index_of(&asset_manager_state->asset_infos, asset_info);
@@ -1170,23 +1323,46 @@ static bool deserialize_asset_registry()
         entry.ref_count = 0;
         entry.state = Asset_State::UNLOADED;
         entry.job = Resource_Pool< Job >::invalid_handle;
-        
-        String absolute_path = internal_get_asset_absolute_path(entry, memory_context.temp_allocator);
-        entry.is_deleted = !file_exists(absolute_path);
+        entry.is_deleted = false;
+
+        insert(&registry, asset_uuid, entry);
+        insert(&asset_manager_state->asset_path_index, entry.path, asset_uuid);
+    }
+
+    // checking the files on disk is the expensive part so it's done in parallel once every entry is in the registry.
+    U32 registry_entry_count = registry.count;
+    Asset_Handle *asset_handles = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, Asset_Handle, registry_entry_count);
+
+    {
+        U32 handle_index = 0;
+        for (auto [uuid, entry] : registry)
+        {
+            asset_handles[handle_index++] = { .uuid = uuid };
+        }
+    }
+
+    // waiting runs other jobs on this thread and they may take the asset mutex, the directory watcher isn't started yet
+    // so nothing else touches the registry while it's released.
+    platform_unlock_mutex(&asset_manager_state->asset_mutex);
+    parallel_for(0, registry_entry_count, 32, &validate_asset_registry_entries, asset_handles);
+    platform_lock_mutex(&asset_manager_state->asset_mutex);
+
+    for (U32 i = 0; i < registry_entry_count; i++)
+    {
+        Asset_Handle asset_handle = asset_handles[i];
+        const Asset_Registry_Entry &entry = internal_get_asset_registry_entry(asset_handle);
 
-        registry.emplace(asset_uuid, entry);
-        
         Asset_Handle embeder_handle = {};
-        bool is_embeded = is_asset_embeded(path, &embeder_handle);
+        bool is_embeded = is_asset_embeded(entry.path, &embeder_handle);
         if (is_embeded && internal_is_asset_handle_valid(embeder_handle))
         {
             internal_add_embeded_asset(embeder_handle, asset_handle);
             internal_add_asset_dependency(embeder_handle, asset_handle);
         }
 
-        if (internal_is_asset_handle_valid(parent_handle))
+        if (internal_is_asset_handle_valid(entry.parent))
         {
-            internal_add_asset_dependency(parent_handle, asset_handle);
+            internal_add_asset_dependency(entry.parent, asset_handle);
         }
     }
 
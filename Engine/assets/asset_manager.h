@@ -57,6 +57,7 @@ struct Asset_Info
     load_asset_proc load;
     unload_asset_proc unload;
     on_import_asset_proc on_import;
+    Memory_Tag memory_tag;
 };
 
 struct Asset_Registry_Entry
@@ -81,7 +82,7 @@ void reload_assets();
 
 String get_asset_path();
 
-bool register_asset(String name, Array_View< String > extensions, load_asset_proc load, unload_asset_proc unload, on_import_asset_proc on_import = nullptr);
+bool register_asset(String name, Array_View< String > extensions, load_asset_proc load, unload_asset_proc unload, on_import_asset_proc on_import = nullptr, Memory_Tag memory_tag = Memory_Tag::ASSETS);
 
 bool is_asset_handle_valid(Asset_Handle asset_handle);
 bool is_asset_of_type(Asset_Handle asset_handle, String type);
@@ -94,6 +95,9 @@ Load_Asset_Result get_asset(Asset_Handle asset_handle);
 
 void release_asset(Asset_Handle asset_handle);
 
+// unloads every asset kept resident after its last release, used at a level change.
+void evict_unreferenced_assets();
+
 void reload_asset(Asset_Handle asset_handle);
 
 Asset_Handle get_asset_handle(String path);
@@ -9,7 +9,7 @@
 #include "rendering/renderer.h"
 #include "rendering/renderer_utils.h" 
 
-#include <ExcaliburHash/ExcaliburHash.h>
+#include "containers/hash_map.h"
 
 struct Model_Instance
 {
@@ -17,7 +17,7 @@ struct Model_Instance
     U32 ref_count;
 };
 
-using Model_Cache = Excalibur::HashMap< U64,  Model_Instance>;
+using Model_Cache = Hash_Map< U64, Model_Instance >;
 
 #pragma warning(push, 0)
 
@@ -111,8 +111,8 @@ static cgltf_data *aquire_model_from_cache(U64 asset_uuid, String path)
 
     cgltf_data *result = nullptr;
 
-    auto it = model_cache.find(asset_uuid);
-    if (it == model_cache.iend())
+    auto it = find(&model_cache, asset_uuid);
+    if (!is_valid(it))
     {
         Read_Entire_File_Result file_result = read_entire_file(path, memory_context.temp_allocator);
 
@@ -133,11 +133,11 @@ static cgltf_data *aquire_model_from_cache(U64 asset_uuid, String path)
             return {};
         }
 
-        model_cache.emplace(asset_uuid, Model_Instance { .data = (void *)result, .ref_count = 1 });
+        insert(&model_cache, asset_uuid, Model_Instance { .data = (void *)result, .ref_count = 1 });
     }
     else
     {
-        Model_Instance &instance = it.value();
+        Model_Instance &instance = *it.value;
         result = (cgltf_data *)instance.data;
         instance.ref_count++;
     }
@@ -149,16 +149,16 @@ static void release_model_from_cache(U64 asset_uuid)
 {
     platform_lock_mutex(&model_cache_mutex);
 
-    auto it = model_cache.find(asset_uuid);
-    HE_ASSERT(it != model_cache.iend());
-    Model_Instance &instance = it.value();
+    auto it = find(&model_cache, asset_uuid);
+    HE_ASSERT(is_valid(it));
+    Model_Instance &instance = *it.value;
     HE_ASSERT(instance.ref_count);
     instance.ref_count--;
 
     if (instance.ref_count == 0)
     {
         cgltf_free((cgltf_data *)instance.data);
-        model_cache.erase(it);
+        remove(&model_cache, asset_uuid);
     }
 
     platform_unlock_mutex(&model_cache_mutex);
@@ -330,16 +330,16 @@ Load_Asset_Result load_model(String path, const Embeded_Asset_Params *params)
         Renderer_State *renderer_state = render_context.renderer_state;
         base_color = linear_to_srgb(base_color);
 
-        set_property(material_handle, HE_STRING_LITERAL("albedo_texture"), { .u64 = albedo_texture.uuid });
-        set_property(material_handle, HE_STRING_LITERAL("albedo_color"), { .v4f = base_color });
-        set_property(material_handle, HE_STRING_LITERAL("normal_texture"), { .u64 = normal_texture.uuid });
-        set_property(material_handle, HE_STRING_LITERAL("roughness_metallic_texture"), { .u64 = roughness_metallic_texture.uuid });
-        set_property(material_handle, HE_STRING_LITERAL("roughness_factor"), { .f32 = material->pbr_metallic_roughness.roughness_factor });
-        set_property(material_handle, HE_STRING_LITERAL("metallic_factor"), { .f32 = material->pbr_metallic_roughness.metallic_factor });
-        set_property(material_handle, HE_STRING_LITERAL("occlusion_texture"), { .u64 = occlusion_texture.uuid });
-        set_property(material_handle, HE_STRING_LITERAL("alpha_cutoff"), { .f32 = alpha_cutoff });
-        set_property(material_handle, HE_STRING_LITERAL("reflectance"), { .f32 = reflectance });
-        set_property(material_handle, HE_STRING_LITERAL("type"), { .u32 = (U32)material_type });
+        set_property(material_handle, HE_NAME("albedo_texture"), { .u64 = albedo_texture.uuid });
+        set_property(material_handle, HE_NAME("albedo_color"), { .v4f = base_color });
+        set_property(material_handle, HE_NAME("normal_texture"), { .u64 = normal_texture.uuid });
+        set_property(material_handle, HE_NAME("roughness_metallic_texture"), { .u64 = roughness_metallic_texture.uuid });
+        set_property(material_handle, HE_NAME("roughness_factor"), { .f32 = material->pbr_metallic_roughness.roughness_factor });
+        set_property(material_handle, HE_NAME("metallic_factor"), { .f32 = material->pbr_metallic_roughness.metallic_factor });
+        set_property(material_handle, HE_NAME("occlusion_texture"), { .u64 = occlusion_texture.uuid });
+        set_property(material_handle, HE_NAME("alpha_cutoff"), { .f32 = alpha_cutoff });
+        set_property(material_handle, HE_NAME("reflectance"), { .f32 = reflectance });
+        set_property(material_handle, HE_NAME("type"), { .u32 = (U32)material_type });
 
         return { .success = true, .index = material_handle.index, .generation = material_handle.generation };
     }
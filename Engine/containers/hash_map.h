@@ -3,69 +3,103 @@
 #include "core/defines.h"
 #include "core/memory.h"
 
-enum class Slot_State : U8
-{
-    EMPTY,
-    OCCUPIED,
-    DELETED
-};
+#include <string.h>
+#include <immintrin.h>
 
-template< typename Key_Type, typename Value_Type >
-struct Hash_Map
+// open addressing with a control byte per slot probed a group of 16 slots at a time,
+// full slots store the low 7 bits of their key hash so most mismatches never touch the keys.
+#define HE_HASH_MAP_GROUP_SIZE 16
+#define HE_HASH_MAP_CONTROL_EMPTY ((S8)-128)
+#define HE_HASH_MAP_CONTROL_DELETED ((S8)-2)
+
+inline U64 hash_key(U64 key)
 {
-    void *memory;
+    return key;
+}
 
-    Slot_State *states;
-    Key_Type *keys;
-    Value_Type *values;
+inline U64 hash_key(U32 key)
+{
+    return key;
+}
 
-    U32 capacity;
-    U32 count;
+// the default hasher calls the hash_key overload of the key or lookup type.
+struct Hash_Key_Hasher
+{
+    template< typename T >
+    HE_FORCE_INLINE U64 operator()(const T &key) const
+    {
+        return hash_key(key);
+    }
+};
 
-    Allocator allocator;
+template< typename Key_Type, typename Value_Type >
+struct Hash_Map_Entry
+{
+    const Key_Type &key;
+    Value_Type &value;
 };
 
 template< typename Key_Type, typename Value_Type >
-void init(Hash_Map< Key_Type, Value_Type > *hash_map, U32 capacity, Allocator allocator = {})
+struct Hash_Map_Entry_Iterator
 {
-    HE_ASSERT(hash_map);
-    HE_ASSERT(capacity);
+    const S8 *controls;
+    Key_Type *keys;
+    Value_Type *values;
+    U32 slot_index;
+    U32 capacity;
 
-    if (!allocator.data)
+    HE_FORCE_INLINE Hash_Map_Entry< Key_Type, Value_Type > operator*() const
     {
-        Memory_Context memory_context = grab_memory_context();
-        allocator = memory_context.general_allocator;
+        return { keys[slot_index], values[slot_index] };
     }
 
-    if ((capacity & (capacity - 1)) != 0)
+    HE_FORCE_INLINE Hash_Map_Entry_Iterator& operator++()
     {
-        U32 new_capacity = 2;
-        capacity--;
-        while (capacity >>= 1)
+        do
         {
-            new_capacity <<= 1;
+            slot_index++;
         }
-        HE_ASSERT((new_capacity & (new_capacity - 1)) == 0);
-        capacity = new_capacity;
+        while (slot_index < capacity && controls[slot_index] < 0);
+        return *this;
     }
 
-    U64 total_size = (sizeof(Slot_State) + sizeof(Key_Type) + sizeof(Value_Type)) * capacity;
-    U8 *memory = HE_ALLOCATOR_ALLOCATE_ARRAY(allocator, U8, total_size);
-    
-    hash_map->memory = memory;
-    hash_map->states = (Slot_State*)memory;
-    hash_map->keys = (Key_Type*)(memory + sizeof(Slot_State) * capacity);
-    hash_map->values = (Value_Type*)(memory + (sizeof(Slot_State) + sizeof(Key_Type)) * capacity);
-    hash_map->capacity = capacity;
-    hash_map->count = 0;
-    hash_map->allocator = allocator;
-}
+    HE_FORCE_INLINE bool operator!=(const Hash_Map_Entry_Iterator &other) const
+    {
+        return slot_index != other.slot_index;
+    }
+};
 
-template< typename Key_Type, typename Value_Type >
-void deinit(Hash_Map< Key_Type, Value_Type > *hash_map)
+// a zeroed hash map is empty and allocates from the general allocator on the first insert.
+template< typename Key_Type, typename Value_Type, typename Hasher = Hash_Key_Hasher >
+struct Hash_Map
 {
-    HE_ALLOCATOR_DEALLOCATE(hash_map->allocator, hash_map->memory);
-}
+    void *memory;
+
+    S8 *controls;
+    Key_Type *keys;
+    Value_Type *values;
+
+    U32 capacity; // a power of 2 and a multiple of the group size.
+    U32 count;
+    U32 growth_left; // empty slots left before a rehash, deleted slots don't count.
+
+    Allocator allocator;
+
+    HE_FORCE_INLINE Hash_Map_Entry_Iterator< Key_Type, Value_Type > begin() const
+    {
+        U32 slot_index = 0;
+        while (slot_index < capacity && controls[slot_index] < 0)
+        {
+            slot_index++;
+        }
+        return { controls, keys, values, slot_index, capacity };
+    }
+
+    HE_FORCE_INLINE Hash_Map_Entry_Iterator< Key_Type, Value_Type > end() const
+    {
+        return { controls, keys, values, capacity, capacity };
+    }
+};
 
 template< typename Value_Type >
 struct Hash_Map_Iterator
@@ -79,104 +113,285 @@ HE_FORCE_INLINE bool is_valid(const Hash_Map_Iterator< Value_Type > &iterator)
     return iterator.value != nullptr;
 }
 
-inline U64 hash_key(U64 key)
+// spreads weak hashes like the identity hash of integers over both the group index and the control byte.
+HE_FORCE_INLINE U64 mix_hash(U64 hash)
 {
-    return key;
+    hash ^= hash >> 32;
+    hash *= 0x9E3779B97F4A7C15ull;
+    hash ^= hash >> 29;
+    return hash;
 }
 
-inline U64 hash_key(U32 key)
+HE_FORCE_INLINE U32 match_control(const S8 *group, S8 control)
 {
-    return key;
+    __m128i controls = _mm_load_si128((const __m128i *)group);
+    return (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8(control)));
 }
 
-template< typename Key_Type, typename Value_Type >
-Hash_Map_Iterator< Value_Type > find(Hash_Map< Key_Type, Value_Type > *hash_map, const Key_Type &key, S32 *out_insert_index = nullptr)
+// empty and deleted are the only control bytes with the sign bit set.
+HE_FORCE_INLINE U32 match_empty_or_deleted(const S8 *group)
 {
-    HE_ASSERT(hash_map);
+    return (U32)_mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+}
 
-    U32 slot_index = hash_key(key) & (hash_map->capacity - 1);
-    U32 start_slot = slot_index;
-    S32 insert_index = -1;
+// groups are visited in triangular steps which covers all of them when the group count is a power of 2.
+template< typename Key_Type, typename Value_Type, typename Hasher >
+U32 find_insert_slot(Hash_Map< Key_Type, Value_Type, Hasher > *hash_map, U64 hash)
+{
+    U32 group_mask = (hash_map->capacity / HE_HASH_MAP_GROUP_SIZE) - 1;
+    U32 group_index = (U32)(hash >> 7) & group_mask;
 
-    Hash_Map_Iterator< Value_Type > result;
-    result.value = nullptr;
+    for (U32 step = 1; ; step++)
+    {
+        const S8 *group = &hash_map->controls[group_index * HE_HASH_MAP_GROUP_SIZE];
+        U32 mask = match_empty_or_deleted(group);
+        if (mask)
+        {
+            return group_index * HE_HASH_MAP_GROUP_SIZE + _tzcnt_u32(mask);
+        }
+        group_index = (group_index + step) & group_mask;
+    }
+}
+
+// rehashes into a table that holds at least min_count entries, also drops every deleted slot.
+template< typename Key_Type, typename Value_Type, typename Hasher >
+void rehash(Hash_Map< Key_Type, Value_Type, Hasher > *hash_map, U32 min_count)
+{
+    HE_ASSERT(hash_map);
+    HE_ASSERT(min_count >= hash_map->count);
 
-    do
+    if (!hash_map->allocator.data)
     {
-        Slot_State *state = &hash_map->states[slot_index];
+        Memory_Context memory_context = grab_memory_context();
+        hash_map->allocator = memory_context.general_allocator;
+    }
+
+    // keeps the load under 7/8 after the rehash.
+    U32 capacity = HE_HASH_MAP_GROUP_SIZE;
+    while (capacity - capacity / 8 < min_count)
+    {
+        capacity *= 2;
+    }
+
+    U64 keys_offset = capacity;
+    keys_offset = (keys_offset + alignof(Key_Type) - 1) & ~((U64)alignof(Key_Type) - 1);
+
+    U64 values_offset = keys_offset + sizeof(Key_Type) * capacity;
+    values_offset = (values_offset + alignof(Value_Type) - 1) & ~((U64)alignof(Value_Type) - 1);
+
+    U64 total_size = values_offset + sizeof(Value_Type) * capacity;
+    U16 alignment = (U16)HE_MAX(HE_MAX(alignof(Key_Type), alignof(Value_Type)), (U64)HE_HASH_MAP_GROUP_SIZE);
+
+    Allocator allocator = hash_map->allocator;
+    U8 *memory = (U8 *)(allocator.allocate_uninitialized ? allocator.allocate_uninitialized : allocator.allocate)(allocator.data, total_size, alignment);
+    HE_ASSERT(memory);
+
+    Hash_Map< Key_Type, Value_Type, Hasher > old_hash_map = *hash_map;
 
-        if (*state == Slot_State::EMPTY)
+    hash_map->memory = memory;
+    hash_map->controls = (S8 *)memory;
+    hash_map->keys = (Key_Type *)(memory + keys_offset);
+    hash_map->values = (Value_Type *)(memory + values_offset);
+    hash_map->capacity = capacity;
+    hash_map->growth_left = capacity - capacity / 8 - old_hash_map.count;
+
+    memset(hash_map->controls, HE_HASH_MAP_CONTROL_EMPTY, capacity);
+
+    Hasher hasher = {};
+
+    for (U32 slot_index = 0; slot_index < old_hash_map.capacity; slot_index++)
+    {
+        if (old_hash_map.controls[slot_index] < 0)
         {
-            if (insert_index == -1)
-            {
-                insert_index = slot_index;
-                break;
-            }
+            continue;
         }
-        else if (*state == Slot_State::OCCUPIED)
+
+        U64 hash = mix_hash(hasher(old_hash_map.keys[slot_index]));
+        U32 insert_slot = find_insert_slot(hash_map, hash);
+        hash_map->controls[insert_slot] = (S8)(hash & 0x7F);
+        hash_map->keys[insert_slot] = old_hash_map.keys[slot_index];
+        hash_map->values[insert_slot] = old_hash_map.values[slot_index];
+    }
+
+    if (old_hash_map.memory)
+    {
+        HE_ALLOCATOR_DEALLOCATE(allocator, old_hash_map.memory);
+    }
+}
+
+template< typename Key_Type, typename Value_Type, typename Hasher >
+void init(Hash_Map< Key_Type, Value_Type, Hasher > *hash_map, U32 capacity = 0, Allocator allocator = {})
+{
+    HE_ASSERT(hash_map);
+
+    zero_memory(hash_map, sizeof(Hash_Map< Key_Type, Value_Type, Hasher >));
+    hash_map->allocator = allocator;
+
+    if (capacity)
+    {
+        rehash(hash_map, capacity);
+    }
+}
+
+template< typename Key_Type, typename Value_Type, typename Hasher >
+void deinit(Hash_Map< Key_Type, Value_Type, Hasher > *hash_map)
+{
+    HE_ASSERT(hash_map);
+
+    if (hash_map->memory)
+    {
+        HE_ALLOCATOR_DEALLOCATE(hash_map->allocator, hash_map->memory);
+    }
+
+    hash_map->memory = nullptr;
+    hash_map->controls = nullptr;
+    hash_map->keys = nullptr;
+    hash_map->values = nullptr;
+    hash_map->capacity = 0;
+    hash_map->count = 0;
+    hash_map->growth_left = 0;
+}
+
+// keeps the memory.
+template< typename Key_Type, typename Value_Type, typename Hasher >
+void reset(Hash_Map< Key_Type, Value_Type, Hasher > *hash_map)
+{
+    HE_ASSERT(hash_map);
+
+    if (hash_map->capacity)
+    {
+        memset(hash_map->controls, HE_HASH_MAP_CONTROL_EMPTY, hash_map->capacity);
+    }
+
+    hash_map->count = 0;
+    hash_map->growth_left = hash_map->capacity - hash_map->capacity / 8;
+}
+
+// lookup can be any type the hasher hashes the same as the key it compares equal to, String keys are found from views without copying.
+template< typename Key_Type, typename Value_Type, typename Hasher, typename Lookup_Type >
+S32 find_slot(const Hash_Map< Key_Type, Value_Type, Hasher > *hash_map, const Lookup_Type &key, U64 hash)
+{
+    if (!hash_map->capacity)
+    {
+        return -1;
+    }
+
+    S8 control = (S8)(hash & 0x7F);
+    U32 group_mask = (hash_map->capacity / HE_HASH_MAP_GROUP_SIZE) - 1;
+    U32 group_index = (U32)(hash >> 7) & group_mask;
+
+    for (U32 step = 1; step <= group_mask + 1; step++)
+    {
+        const S8 *group = &hash_map->controls[group_index * HE_HASH_MAP_GROUP_SIZE];
+
+        for (U32 mask = match_control(group, control); mask; mask &= mask - 1)
         {
+            U32 slot_index = group_index * HE_HASH_MAP_GROUP_SIZE + _tzcnt_u32(mask);
             if (hash_map->keys[slot_index] == key)
             {
-                result.value = &hash_map->values[slot_index];
-                insert_index = slot_index;
-                break;
+                return (S32)slot_index;
             }
         }
-        else if (*state == Slot_State::DELETED)
+
+        if (match_control(group, HE_HASH_MAP_CONTROL_EMPTY))
         {
-            if (insert_index == -1)
-            {
-                insert_index = slot_index;
-            }
+            break;
         }
 
-        slot_index = (slot_index + 1) & (hash_map->capacity - 1);
+        group_index = (group_index + step) & group_mask;
     }
-    while (slot_index != start_slot);
 
-    if (out_insert_index)
-    {
-        *out_insert_index = insert_index;
-    }
+    return -1;
+}
+
+template< typename Key_Type, typename Value_Type, typename Hasher, typename Lookup_Type >
+Hash_Map_Iterator< Value_Type > find(Hash_Map< Key_Type, Value_Type, Hasher > *hash_map, const Lookup_Type &key)
+{
+    HE_ASSERT(hash_map);
 
+    Hasher hasher = {};
+    S32 slot_index = find_slot(hash_map, key, mix_hash(hasher(key)));
+
+    Hash_Map_Iterator< Value_Type > result;
+    result.value = slot_index != -1 ? &hash_map->values[slot_index] : nullptr;
     return result;
 }
 
-template< typename Key_Type, typename Value_Type >
-S32 insert(Hash_Map< Key_Type, Value_Type > *hash_map, const Key_Type &key, const Value_Type &value = {})
+// overwrites the value of an existing key, the returned pointer is valid until the next insert.
+template< typename Key_Type, typename Value_Type, typename Hasher >
+Value_Type* insert(Hash_Map< Key_Type, Value_Type, Hasher > *hash_map, const Key_Type &key, const Value_Type &value = {})
 {
     HE_ASSERT(hash_map);
-    HE_ASSERT(hash_map->count < hash_map->capacity);
 
-    S32 insert_index = -1;
-    auto it = find(hash_map, key, &insert_index);
-    if (is_valid(it))
+    Hasher hasher = {};
+    U64 hash = mix_hash(hasher(key));
+
+    S32 slot_index = find_slot(hash_map, key, hash);
+    if (slot_index != -1)
     {
-        hash_map->values[insert_index] = value;
+        hash_map->values[slot_index] = value;
+        return &hash_map->values[slot_index];
     }
-    else
+
+    U32 insert_slot = 0;
+
+    if (hash_map->capacity)
+    {
+        insert_slot = find_insert_slot(hash_map, hash);
+    }
+
+    // reusing a deleted slot doesn't use up growth, running out rehashes in place when
+    // most of the table is deleted slots and grows otherwise.
+    if (!hash_map->capacity || (hash_map->controls[insert_slot] == HE_HASH_MAP_CONTROL_EMPTY && !hash_map->growth_left))
+    {
+        U32 max_count = hash_map->capacity - hash_map->capacity / 8;
+        U32 min_count = hash_map->count + 1;
+        if (hash_map->count >= max_count / 2)
+        {
+            min_count = HE_MAX(min_count, max_count * 2);
+        }
+
+        rehash(hash_map, min_count);
+        insert_slot = find_insert_slot(hash_map, hash);
+    }
+
+    if (hash_map->controls[insert_slot] == HE_HASH_MAP_CONTROL_EMPTY)
     {
-        HE_ASSERT(insert_index != -1);
-        hash_map->states[insert_index] = Slot_State::OCCUPIED;
-        hash_map->keys[insert_index] = key;
-        hash_map->values[insert_index] = value;
-        hash_map->count++;
+        hash_map->growth_left--;
     }
 
-    return insert_index;
+    hash_map->controls[insert_slot] = (S8)(hash & 0x7F);
+    hash_map->keys[insert_slot] = key;
+    hash_map->values[insert_slot] = value;
+    hash_map->count++;
+    return &hash_map->values[insert_slot];
 }
 
-template< typename Key_Type, typename Value_Type >
-void remove(Hash_Map< Key_Type, Value_Type > *hash_map, const Key_Type &key)
+template< typename Key_Type, typename Value_Type, typename Hasher, typename Lookup_Type >
+bool remove(Hash_Map< Key_Type, Value_Type, Hasher > *hash_map, const Lookup_Type &key)
 {
     HE_ASSERT(hash_map);
-    HE_ASSERT(hash_map->count);
 
-    S32 slot_index = -1;
-    auto it = find(hash_map, key, &slot_index);
-    if (is_valid(it))
+    Hasher hasher = {};
+    S32 slot_index = find_slot(hash_map, key, mix_hash(hasher(key)));
+    if (slot_index == -1)
+    {
+        return false;
+    }
+
+    // a group with an empty slot never filled up since the last rehash so no probe went past it and
+    // the slot can be emptied, otherwise it stays deleted until the next rehash.
+    const S8 *group = &hash_map->controls[slot_index & ~(HE_HASH_MAP_GROUP_SIZE - 1)];
+    if (match_control(group, HE_HASH_MAP_CONTROL_EMPTY))
     {
-        hash_map->states[slot_index] = Slot_State::DELETED;
-        hash_map->count--;
+        hash_map->controls[slot_index] = HE_HASH_MAP_CONTROL_EMPTY;
+        hash_map->growth_left++;
     }
-}
\ No newline at end of file
+    else
+    {
+        hash_map->controls[slot_index] = HE_HASH_MAP_CONTROL_DELETED;
+    }
+
+    hash_map->count--;
+    return true;
+}
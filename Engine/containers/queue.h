@@ -2,6 +2,28 @@
 
 #include "core/defines.h"
 #include "core/memory.h"
+#include "core/platform.h"
+
+#include <atomic>
+#include <type_traits>
+
+// the queues index with a mask so their capacity is rounded up to a power of two.
+HE_FORCE_INLINE U32 round_queue_capacity(U32 capacity)
+{
+    if ((capacity & (capacity - 1)) != 0)
+    {
+        U32 new_capacity = 2;
+        capacity--;
+        while (capacity >>= 1)
+        {
+            new_capacity <<= 1;
+        }
+        HE_ASSERT((new_capacity & (new_capacity - 1)) == 0);
+        capacity = new_capacity;
+    }
+
+    return capacity;
+}
 
 template< typename T >
 struct Ring_Queue
@@ -17,17 +39,7 @@ struct Ring_Queue
 template< typename T >
 void init(Ring_Queue< T > *queue, U32 capacity, Allocator allocator = {})
 {
-    if ((capacity & (capacity - 1)) != 0)
-    {
-        U32 new_capacity = 2;
-        capacity--;
-        while (capacity >>= 1)
-        {
-            new_capacity <<= 1;
-        }
-        HE_ASSERT((new_capacity & (new_capacity - 1)) == 0);
-        capacity = new_capacity;
-    }
+    capacity = round_queue_capacity(capacity);
 
     if (!allocator.data)
     {
@@ -124,4 +136,481 @@ void pop_back(Ring_Queue< T > *queue)
 {
     HE_ASSERT(!empty(queue));
     queue->write--;
-}
\ No newline at end of file
+}
+
+//
+// Work Stealing Queue (Chase-Lev)
+// push and pop are only allowed from the owner thread, steal can be called from any thread.
+//
+
+template< typename T >
+struct Work_Stealing_Queue
+{
+    static_assert(std::is_trivially_copyable_v< T >);
+
+    std::atomic< T > *data;
+    U32 capacity;
+    U32 mask;
+    Allocator allocator;
+
+    alignas(64) std::atomic< S64 > top;
+    alignas(64) std::atomic< S64 > bottom;
+};
+
+template< typename T >
+void init(Work_Stealing_Queue< T > *queue, U32 capacity, Allocator allocator = {})
+{
+    HE_ASSERT(queue);
+    HE_ASSERT(capacity);
+
+    capacity = round_queue_capacity(capacity);
+
+    if (!allocator.data)
+    {
+        Memory_Context memory_context = grab_memory_context();
+        allocator = memory_context.general_allocator;
+    }
+
+    queue->data = HE_ALLOCATOR_ALLOCATE_ARRAY(allocator, std::atomic< T >, capacity);
+    queue->capacity = capacity;
+    queue->mask = capacity - 1;
+    queue->allocator = allocator;
+    queue->top.store(0, std::memory_order_relaxed);
+    queue->bottom.store(0, std::memory_order_relaxed);
+}
+
+template< typename T >
+void deinit(Work_Stealing_Queue< T > *queue)
+{
+    HE_ALLOCATOR_DEALLOCATE(queue->allocator, queue->data);
+}
+
+// approximate when called from a thread other than the owner.
+template< typename T >
+U32 count(Work_Stealing_Queue< T > *queue)
+{
+    S64 bottom = queue->bottom.load(std::memory_order_relaxed);
+    S64 top = queue->top.load(std::memory_order_relaxed);
+    return bottom > top ? (U32)(bottom - top) : 0;
+}
+
+template< typename T >
+bool push(Work_Stealing_Queue< T > *queue, const T &item)
+{
+    S64 bottom = queue->bottom.load(std::memory_order_relaxed);
+    S64 top = queue->top.load(std::memory_order_acquire);
+
+    if (bottom - top >= (S64)queue->capacity)
+    {
+        return false;
+    }
+
+    queue->data[bottom & queue->mask].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    queue->bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+template< typename T >
+bool pop(Work_Stealing_Queue< T > *queue, T *out_item)
+{
+    HE_ASSERT(out_item);
+
+    S64 bottom = queue->bottom.load(std::memory_order_relaxed) - 1;
+    queue->bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    S64 top = queue->top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        queue->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    *out_item = queue->data[bottom & queue->mask].load(std::memory_order_relaxed);
+
+    if (top == bottom)
+    {
+        // last item, race against stealers.
+        bool won = queue->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        queue->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    return true;
+}
+
+template< typename T >
+bool steal(Work_Stealing_Queue< T > *queue, T *out_item)
+{
+    HE_ASSERT(out_item);
+
+    S64 top = queue->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    S64 bottom = queue->bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return false;
+    }
+
+    T item = queue->data[top & queue->mask].load(std::memory_order_relaxed);
+    if (!queue->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    *out_item = item;
+    return true;
+}
+
+// indices written by different threads are kept on their own cache lines so producers and consumers don't false share.
+#define HE_QUEUE_CACHE_LINE_SIZE 64
+
+//
+// MPMC Queue (Vyukov)
+// bounded lock-free queue, push and pop can be called from any thread.
+//
+
+template< typename T >
+struct MPMC_Queue_Cell
+{
+    // equals the position of the push that can write the cell, or that position + 1 once the item can be popped.
+    std::atomic< U64 > sequence;
+    T item;
+};
+
+template< typename T >
+struct MPMC_Queue
+{
+    static_assert(std::is_trivially_copyable_v< T >);
+
+    MPMC_Queue_Cell< T > *cells;
+    U32 capacity;
+    U32 mask;
+    Allocator allocator;
+
+    alignas(HE_QUEUE_CACHE_LINE_SIZE) std::atomic< U64 > push_position;
+    alignas(HE_QUEUE_CACHE_LINE_SIZE) std::atomic< U64 > pop_position;
+};
+
+template< typename T >
+void init(MPMC_Queue< T > *queue, U32 capacity, Allocator allocator = {})
+{
+    HE_ASSERT(queue);
+    HE_ASSERT(capacity);
+
+    capacity = round_queue_capacity(capacity);
+
+    if (!allocator.data)
+    {
+        Memory_Context memory_context = grab_memory_context();
+        allocator = memory_context.general_allocator;
+    }
+
+    queue->cells = HE_ALLOCATOR_ALLOCATE_ARRAY(allocator, MPMC_Queue_Cell< T >, capacity);
+    queue->capacity = capacity;
+    queue->mask = capacity - 1;
+    queue->allocator = allocator;
+
+    for (U32 cell_index = 0; cell_index < capacity; cell_index++)
+    {
+        queue->cells[cell_index].sequence.store(cell_index, std::memory_order_relaxed);
+    }
+
+    queue->push_position.store(0, std::memory_order_relaxed);
+    queue->pop_position.store(0, std::memory_order_relaxed);
+}
+
+template< typename T >
+void deinit(MPMC_Queue< T > *queue)
+{
+    HE_ALLOCATOR_DEALLOCATE(queue->allocator, queue->cells);
+}
+
+// approximate while other threads push or pop.
+template< typename T >
+U32 count(MPMC_Queue< T > *queue)
+{
+    U64 pop_position = queue->pop_position.load(std::memory_order_relaxed);
+    U64 push_position = queue->push_position.load(std::memory_order_relaxed);
+    return push_position > pop_position ? (U32)HE_MIN(push_position - pop_position, (U64)queue->capacity) : 0;
+}
+
+template< typename T >
+bool push(MPMC_Queue< T > *queue, const T &item)
+{
+    U64 position = queue->push_position.load(std::memory_order_relaxed);
+    MPMC_Queue_Cell< T > *cell = nullptr;
+
+    while (true)
+    {
+        cell = &queue->cells[position & queue->mask];
+        U64 sequence = cell->sequence.load(std::memory_order_acquire);
+        S64 difference = (S64)(sequence - position);
+
+        if (difference == 0)
+        {
+            if (queue->push_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // the cell still holds the item pushed a lap ago.
+            return false;
+        }
+        else
+        {
+            position = queue->push_position.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->item = item;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+template< typename T >
+bool pop(MPMC_Queue< T > *queue, T *out_item)
+{
+    HE_ASSERT(out_item);
+
+    U64 position = queue->pop_position.load(std::memory_order_relaxed);
+    MPMC_Queue_Cell< T > *cell = nullptr;
+
+    while (true)
+    {
+        cell = &queue->cells[position & queue->mask];
+        U64 sequence = cell->sequence.load(std::memory_order_acquire);
+        S64 difference = (S64)(sequence - (position + 1));
+
+        if (difference == 0)
+        {
+            if (queue->pop_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // the push for this position hasn't finished writing the item.
+            return false;
+        }
+        else
+        {
+            position = queue->pop_position.load(std::memory_order_relaxed);
+        }
+    }
+
+    *out_item = cell->item;
+    cell->sequence.store(position + queue->capacity, std::memory_order_release);
+    return true;
+}
+
+//
+// SPSC Queue
+// bounded lock-free queue, push is only allowed from one producer thread and pop from one consumer thread.
+//
+
+template< typename T >
+struct SPSC_Queue
+{
+    static_assert(std::is_trivially_copyable_v< T >);
+
+    T *data;
+    U32 capacity;
+    U32 mask;
+    Allocator allocator;
+
+    // each side keeps the last index it read from the other side and only reloads it when the queue looks full or empty.
+    alignas(HE_QUEUE_CACHE_LINE_SIZE) std::atomic< U32 > write;
+    U32 cached_read;
+
+    alignas(HE_QUEUE_CACHE_LINE_SIZE) std::atomic< U32 > read;
+    U32 cached_write;
+};
+
+template< typename T >
+void init(SPSC_Queue< T > *queue, U32 capacity, Allocator allocator = {})
+{
+    HE_ASSERT(queue);
+    HE_ASSERT(capacity);
+
+    capacity = round_queue_capacity(capacity);
+
+    if (!allocator.data)
+    {
+        Memory_Context memory_context = grab_memory_context();
+        allocator = memory_context.general_allocator;
+    }
+
+    queue->data = HE_ALLOCATOR_ALLOCATE_ARRAY(allocator, T, capacity);
+    queue->capacity = capacity;
+    queue->mask = capacity - 1;
+    queue->allocator = allocator;
+    queue->write.store(0, std::memory_order_relaxed);
+    queue->cached_read = 0;
+    queue->read.store(0, std::memory_order_relaxed);
+    queue->cached_write = 0;
+}
+
+template< typename T >
+void deinit(SPSC_Queue< T > *queue)
+{
+    HE_ALLOCATOR_DEALLOCATE(queue->allocator, queue->data);
+}
+
+// approximate when called from a thread other than the producer or the consumer.
+template< typename T >
+U32 count(SPSC_Queue< T > *queue)
+{
+    U32 read = queue->read.load(std::memory_order_acquire);
+    U32 write = queue->write.load(std::memory_order_acquire);
+    return write - read;
+}
+
+template< typename T >
+bool push(SPSC_Queue< T > *queue, const T &item)
+{
+    U32 write = queue->write.load(std::memory_order_relaxed);
+
+    if (write - queue->cached_read == queue->capacity)
+    {
+        queue->cached_read = queue->read.load(std::memory_order_acquire);
+        if (write - queue->cached_read == queue->capacity)
+        {
+            return false;
+        }
+    }
+
+    queue->data[write & queue->mask] = item;
+    queue->write.store(write + 1, std::memory_order_release);
+    return true;
+}
+
+template< typename T >
+bool pop(SPSC_Queue< T > *queue, T *out_item)
+{
+    HE_ASSERT(out_item);
+
+    U32 read = queue->read.load(std::memory_order_relaxed);
+
+    if (read == queue->cached_write)
+    {
+        queue->cached_write = queue->write.load(std::memory_order_acquire);
+        if (read == queue->cached_write)
+        {
+            return false;
+        }
+    }
+
+    *out_item = queue->data[read & queue->mask];
+    queue->read.store(read + 1, std::memory_order_release);
+    return true;
+}
+
+//
+// Blocking Queue
+// a mpmc queue where pop_or_wait sleeps on the push count instead of spinning while the queue is empty.
+//
+
+template< typename T >
+struct Blocking_Queue
+{
+    MPMC_Queue< T > queue;
+
+    alignas(HE_QUEUE_CACHE_LINE_SIZE) std::atomic< U32 > push_count; // the address consumers sleep on, wraps around.
+    std::atomic< U32 > waiting_count;
+    std::atomic< bool > closed;
+};
+
+template< typename T >
+void init(Blocking_Queue< T > *queue, U32 capacity, Allocator allocator = {})
+{
+    HE_ASSERT(queue);
+
+    init(&queue->queue, capacity, allocator);
+    queue->push_count.store(0, std::memory_order_relaxed);
+    queue->waiting_count.store(0, std::memory_order_relaxed);
+    queue->closed.store(false, std::memory_order_relaxed);
+}
+
+template< typename T >
+void deinit(Blocking_Queue< T > *queue)
+{
+    deinit(&queue->queue);
+}
+
+template< typename T >
+U32 count(Blocking_Queue< T > *queue)
+{
+    return count(&queue->queue);
+}
+
+inline void wake_blocking_queue_waiters(std::atomic< U32 > *push_count, std::atomic< U32 > *waiting_count)
+{
+    // pairs with the fence in pop_or_wait so a consumer that is about to sleep either sees the new push count or gets woken.
+    push_count->fetch_add(1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (waiting_count->load(std::memory_order_relaxed))
+    {
+        platform_wake_all_on_address(push_count);
+    }
+}
+
+// doesn't block when the queue is full.
+template< typename T >
+bool push(Blocking_Queue< T > *queue, const T &item)
+{
+    if (!push(&queue->queue, item))
+    {
+        return false;
+    }
+
+    wake_blocking_queue_waiters(&queue->push_count, &queue->waiting_count);
+    return true;
+}
+
+template< typename T >
+bool pop(Blocking_Queue< T > *queue, T *out_item)
+{
+    return pop(&queue->queue, out_item);
+}
+
+// sleeps until an item is popped or the queue is closed and empty, returns false only in the latter case.
+template< typename T >
+bool pop_or_wait(Blocking_Queue< T > *queue, T *out_item)
+{
+    while (true)
+    {
+        U32 push_count = queue->push_count.load(std::memory_order_acquire);
+
+        if (pop(&queue->queue, out_item))
+        {
+            return true;
+        }
+
+        if (queue->closed.load(std::memory_order_acquire))
+        {
+            return pop(&queue->queue, out_item);
+        }
+
+        queue->waiting_count.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // a push that finished after the load above changed the push count and the wait returns right away.
+        platform_wait_on_address(&queue->push_count, &push_count, sizeof(U32));
+        queue->waiting_count.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+// wakes every waiting consumer, items pushed before closing can still be popped.
+template< typename T >
+void close(Blocking_Queue< T > *queue)
+{
+    queue->closed.store(true, std::memory_order_release);
+    wake_blocking_queue_waiters(&queue->push_count, &queue->waiting_count);
+}
@@ -4,6 +4,16 @@
 #include "core/memory.h"
 #include "core/platform.h"
 
+#include <atomic>
+#include <immintrin.h>
+
+// pools grow a page of slots at a time, the slots of a page fill whole os pages so a page can be commited and decommited on its own.
+#define HE_RESOURCE_POOL_OS_PAGE_SIZE HE_KILO_BYTES(4)
+#define HE_RESOURCE_POOL_MIN_PAGE_SLOT_COUNT 64
+
+// set in the live count of a page while its slot memory is decommited.
+#define HE_RESOURCE_POOL_PAGE_DECOMMITED 0x80000000u
+
 template< typename T >
 struct Resource_Handle
 {
@@ -21,112 +31,267 @@ struct Resource_Handle
     }
 };
 
-struct Resource_Pool_Node
+// called with the page mutex held each time the pool adds slots, arrays kept next to the pool commit their memory for
+// the new slots here so every index below the capacity is backed.
+typedef bool(*on_grow_resource_pool_proc)(U32 first_index, U32 slot_count, void *user_data);
+
+// the smallest power of two slot count that is a whole number of os pages.
+template< typename T >
+constexpr U32 get_resource_pool_page_slot_count()
 {
-    S32 next;
-};
+    U64 alignment = sizeof(T) & (~sizeof(T) + 1); // largest power of two that divides sizeof(T).
+    U64 slot_count = HE_RESOURCE_POOL_OS_PAGE_SIZE / HE_MIN(alignment, HE_RESOURCE_POOL_OS_PAGE_SIZE);
+    return (U32)HE_MAX(slot_count, (U64)HE_RESOURCE_POOL_MIN_PAGE_SLOT_COUNT);
+}
 
+// lock-free pool that reserves address space for max_capacity slots and commits it a page at a time, slots never move.
+// a slot generation is odd while the slot is in use so a handle is valid as long as the generation of its slot still
+// matches the one it was acquired with, generations are never decommited so stale handles can always be checked.
 template< typename T >
 struct Resource_Pool
 {
     constexpr static Resource_Handle< T > invalid_handle = { -1, 0 };
-
-    static_assert(sizeof(T) >= sizeof(U32));
+    constexpr static U32 page_slot_count = get_resource_pool_page_slot_count< T >();
 
     void *memory;
 
     T *data;
-    U32 *generations;
-    bool *is_allocated;
+    std::atomic< U32 > *generations;
+    std::atomic< S32 > *next_free_indices;
+    std::atomic< U32 > *page_live_counts;
+    std::atomic< U64 > *occupancy; // a bit per slot that is set while the slot is in use, next() skips empty slots 64 at a time.
 
-    S32 first_free_node_index;
+    // index of the first free slot in the low 32 bits and a tag that changes on every update in the high 32 bits,
+    // a slot that is popped and pushed back between a load and a compare exchange fails the exchange.
+    std::atomic< U64 > free_list_head;
 
-    U32 capacity;
-    U32 count;
+    std::atomic< U32 > capacity; // slots in the pages added so far, never shrinks.
+    U32 max_capacity;
+    std::atomic< U32 > count;
 
-    Allocator allocator;
+    Mutex page_mutex; // adding, decommiting and recommiting pages.
 
-    Mutex mutex;
+    on_grow_resource_pool_proc on_grow;
+    void *on_grow_user_data;
 };
 
+HE_FORCE_INLINE U64 align_to_os_page(U64 size)
+{
+    return (size + HE_RESOURCE_POOL_OS_PAGE_SIZE - 1) & ~(HE_RESOURCE_POOL_OS_PAGE_SIZE - 1);
+}
+
+// commits the os pages that overlap [offset, offset + size), commiting a page twice is fine.
+HE_FORCE_INLINE bool commit_os_pages(void *base, U64 offset, U64 size)
+{
+    U64 begin = offset & ~(HE_RESOURCE_POOL_OS_PAGE_SIZE - 1);
+    U64 end = align_to_os_page(offset + size);
+    return platform_commit_memory((U8 *)base + begin, end - begin);
+}
+
+template< typename T >
+bool grow(Resource_Pool< T > *resource_pool)
+{
+    platform_lock_mutex(&resource_pool->page_mutex);
+    HE_DEFER { platform_unlock_mutex(&resource_pool->page_mutex); };
+
+    // another thread added a page while this one waited for the lock.
+    if ((S32)(U32)resource_pool->free_list_head.load(std::memory_order_acquire) != -1)
+    {
+        return true;
+    }
+
+    U32 capacity = resource_pool->capacity.load(std::memory_order_relaxed);
+    U32 slot_count = HE_MIN(Resource_Pool< T >::page_slot_count, resource_pool->max_capacity - capacity);
+    if (!slot_count)
+    {
+        return false;
+    }
+
+    bool commited = platform_commit_memory(&resource_pool->data[capacity], sizeof(T) * Resource_Pool< T >::page_slot_count);
+    commited &= commit_os_pages(resource_pool->generations, sizeof(U32) * capacity, sizeof(U32) * slot_count);
+    commited &= commit_os_pages(resource_pool->next_free_indices, sizeof(S32) * capacity, sizeof(S32) * slot_count);
+    commited &= commit_os_pages(resource_pool->occupancy, capacity / 8, Resource_Pool< T >::page_slot_count / 8);
+    if (!commited)
+    {
+        return false;
+    }
+
+    if (resource_pool->on_grow && !resource_pool->on_grow(capacity, slot_count, resource_pool->on_grow_user_data))
+    {
+        return false;
+    }
+
+    U32 first_index = capacity;
+    U32 last_index = capacity + slot_count - 1;
+
+    for (U32 slot_index = first_index; slot_index < last_index; slot_index++)
+    {
+        resource_pool->next_free_indices[slot_index].store((S32)(slot_index + 1), std::memory_order_relaxed);
+    }
+
+    resource_pool->capacity.store(capacity + slot_count, std::memory_order_release);
+
+    U64 head = resource_pool->free_list_head.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        resource_pool->next_free_indices[last_index].store((S32)(U32)head, std::memory_order_relaxed);
+
+        U64 tag = (head >> 32) + 1;
+        U64 new_head = (tag << 32) | first_index;
+
+        if (resource_pool->free_list_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+
+    return true;
+}
+
 template< typename T >
-void init(Resource_Pool< T > *resource_pool, U32 capacity, Allocator allocator)
+bool init(Resource_Pool< T > *resource_pool, U32 max_capacity)
 {
     HE_ASSERT(resource_pool);
-    HE_ASSERT(capacity);
+    HE_ASSERT(max_capacity);
+
+    U32 page_count = (max_capacity + Resource_Pool< T >::page_slot_count - 1) / Resource_Pool< T >::page_slot_count;
+    U64 slot_count = (U64)page_count * Resource_Pool< T >::page_slot_count;
+
+    U64 data_size = align_to_os_page(sizeof(T) * slot_count);
+    U64 generations_size = align_to_os_page(sizeof(U32) * slot_count);
+    U64 next_free_indices_size = align_to_os_page(sizeof(S32) * slot_count);
+    U64 page_live_counts_size = align_to_os_page(sizeof(U32) * page_count);
+    U64 occupancy_size = align_to_os_page(slot_count / 8);
+
+    U8 *memory = (U8 *)platform_reserve_memory(data_size + generations_size + next_free_indices_size + page_live_counts_size + occupancy_size);
+    if (!memory)
+    {
+        return false;
+    }
 
-    U64 size = (sizeof(T) + sizeof(U32) + sizeof(bool)) * capacity;
-    U8 *memory = HE_ALLOCATOR_ALLOCATE_ARRAY(allocator, U8, size);
     resource_pool->memory = memory;
     resource_pool->data = (T *)memory;
-    resource_pool->generations = (U32 *)(memory + sizeof(T) * capacity);
-    resource_pool->is_allocated = (bool *)(memory + (sizeof(T) + sizeof(U32)) * capacity);
+    resource_pool->generations = (std::atomic< U32 > *)(memory + data_size);
+    resource_pool->next_free_indices = (std::atomic< S32 > *)(memory + data_size + generations_size);
+    resource_pool->page_live_counts = (std::atomic< U32 > *)(memory + data_size + generations_size + next_free_indices_size);
+    resource_pool->occupancy = (std::atomic< U64 > *)(memory + data_size + generations_size + next_free_indices_size + page_live_counts_size);
 
-    for (U32 slot_index = 0; slot_index < capacity - 1; slot_index++)
+    if (!platform_commit_memory(resource_pool->page_live_counts, page_live_counts_size))
     {
-        Resource_Pool_Node *node = (Resource_Pool_Node *)&resource_pool->data[slot_index];
-        node->next = slot_index + 1;
+        return false;
     }
-    Resource_Pool_Node *last_node = (Resource_Pool_Node *)&resource_pool->data[capacity - 1];
-    last_node->next = -1;
-    resource_pool->first_free_node_index = 0;
 
-    zero_memory(resource_pool->generations, sizeof(U32) * capacity);
-    zero_memory(resource_pool->is_allocated, sizeof(bool) * capacity);
+    resource_pool->free_list_head.store((U32)-1, std::memory_order_relaxed);
+    resource_pool->capacity.store(0, std::memory_order_relaxed);
+    resource_pool->max_capacity = max_capacity;
+    resource_pool->count.store(0, std::memory_order_relaxed);
+    resource_pool->on_grow = nullptr;
+    resource_pool->on_grow_user_data = nullptr;
 
-    resource_pool->capacity = capacity;
-    resource_pool->count = 0;
-    resource_pool->allocator = allocator;
+    if (!platform_create_mutex(&resource_pool->page_mutex))
+    {
+        return false;
+    }
 
-    platform_create_mutex(&resource_pool->mutex);
+    return grow(resource_pool);
+}
+
+// also calls on_grow for the slots the pool already has.
+template< typename T >
+bool set_on_grow(Resource_Pool< T > *resource_pool, on_grow_resource_pool_proc on_grow, void *user_data)
+{
+    HE_ASSERT(resource_pool);
+    HE_ASSERT(on_grow);
+
+    platform_lock_mutex(&resource_pool->page_mutex);
+    HE_DEFER { platform_unlock_mutex(&resource_pool->page_mutex); };
+
+    resource_pool->on_grow = on_grow;
+    resource_pool->on_grow_user_data = user_data;
+
+    U32 capacity = resource_pool->capacity.load(std::memory_order_relaxed);
+    return !capacity || on_grow(0, capacity, user_data);
 }
 
 template< typename T >
 void deinit(Resource_Pool< T > *resource_pool)
 {
     HE_ASSERT(resource_pool);
-    HE_ALLOCATOR_DEALLOCATE(resource_pool->allocator, resource_pool->memory);
+    platform_deallocate_memory(resource_pool->memory);
 }
 
 template< typename T >
 HE_FORCE_INLINE bool is_valid_handle(Resource_Pool< T > *resource_pool, Resource_Handle< T > handle)
 {
     HE_ASSERT(resource_pool);
-    platform_lock_mutex(&resource_pool->mutex);
-
-    bool result = handle.index >= 0 && handle.index < (S32)resource_pool->capacity && resource_pool->is_allocated[handle.index] && resource_pool->generations[handle.index] == handle.generation;
-    
-    platform_unlock_mutex(&resource_pool->mutex);
-
-    return result;
+    return (handle.generation & 1) && handle.index >= 0 && (U32)handle.index < resource_pool->capacity.load(std::memory_order_acquire) &&
+           resource_pool->generations[handle.index].load(std::memory_order_acquire) == handle.generation;
 }
 
 template< typename T >
 Resource_Handle< T > acquire_handle(Resource_Pool< T > *resource_pool)
 {
     HE_ASSERT(resource_pool);
-    HE_ASSERT(resource_pool->count < resource_pool->capacity);
-    HE_ASSERT(resource_pool->first_free_node_index >= 0 && (U32)resource_pool->first_free_node_index < resource_pool->capacity);
 
-    platform_lock_mutex(&resource_pool->mutex);
+    U64 head = resource_pool->free_list_head.load(std::memory_order_acquire);
+    S32 index = -1;
+
+    while (true)
+    {
+        index = (S32)(U32)head;
 
-    S32 index = resource_pool->first_free_node_index;
-    HE_ASSERT(!resource_pool->is_allocated[index]);
+        if (index == -1)
+        {
+            bool grown = grow(resource_pool);
+            HE_ASSERT(grown && "resource pool is full");
+            if (!grown)
+            {
+                return Resource_Pool< T >::invalid_handle;
+            }
+
+            head = resource_pool->free_list_head.load(std::memory_order_acquire);
+            continue;
+        }
 
-    Resource_Pool_Node *node = (Resource_Pool_Node *)&resource_pool->data[index];
-    resource_pool->first_free_node_index = node->next;
-    resource_pool->count++;
-    resource_pool->is_allocated[index] = true;
-    Resource_Handle< T > handle = { index, resource_pool->generations[index] };
+        U64 tag = (head >> 32) + 1;
+        U64 new_head = (tag << 32) | (U32)resource_pool->next_free_indices[index].load(std::memory_order_relaxed);
+
+        if (resource_pool->free_list_head.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            break;
+        }
+    }
+
+    // a page can't be decommited while it has a live slot, once this slot counts a trim has either finished or will skip the page.
+    U32 page_index = (U32)index / Resource_Pool< T >::page_slot_count;
+    U32 live_count = resource_pool->page_live_counts[page_index].fetch_add(1, std::memory_order_acq_rel);
+
+    if (live_count & HE_RESOURCE_POOL_PAGE_DECOMMITED)
+    {
+        platform_lock_mutex(&resource_pool->page_mutex);
+
+        if (resource_pool->page_live_counts[page_index].load(std::memory_order_relaxed) & HE_RESOURCE_POOL_PAGE_DECOMMITED)
+        {
+            T *page = &resource_pool->data[page_index * Resource_Pool< T >::page_slot_count];
+            bool commited = platform_commit_memory(page, sizeof(T) * Resource_Pool< T >::page_slot_count);
+            HE_ASSERT(commited);
+            resource_pool->page_live_counts[page_index].fetch_and(~HE_RESOURCE_POOL_PAGE_DECOMMITED, std::memory_order_release);
+        }
+
+        platform_unlock_mutex(&resource_pool->page_mutex);
+    }
 
-    platform_unlock_mutex(&resource_pool->mutex);
-    
     zero_memory(&resource_pool->data[index], sizeof(T));
-    return handle;
+    resource_pool->count.fetch_add(1, std::memory_order_relaxed);
+
+    U32 generation = resource_pool->generations[index].fetch_add(1, std::memory_order_acq_rel) + 1;
+    resource_pool->occupancy[index / 64].fetch_or(1ull << (index % 64), std::memory_order_release);
+    return { .index = index, .generation = generation };
 }
 
 template< typename T >
-T* get(Resource_Pool< T > *resource_pool, Resource_Handle< T > handle)
+HE_FORCE_INLINE T* get(Resource_Pool< T > *resource_pool, Resource_Handle< T > handle)
 {
     HE_ASSERT(resource_pool);
     HE_ASSERT(is_valid_handle(resource_pool, handle));
@@ -137,19 +302,72 @@ template< typename T >
 void release_handle(Resource_Pool< T > *resource_pool, Resource_Handle< T > handle)
 {
     HE_ASSERT(resource_pool);
-    HE_ASSERT(resource_pool->count);
     HE_ASSERT(is_valid_handle(resource_pool, handle));
 
-    platform_lock_mutex(&resource_pool->mutex);
+    resource_pool->occupancy[handle.index / 64].fetch_and(~(1ull << (handle.index % 64)), std::memory_order_relaxed);
+    resource_pool->generations[handle.index].fetch_add(1, std::memory_order_acq_rel);
+    resource_pool->count.fetch_sub(1, std::memory_order_relaxed);
+
+    U32 page_index = (U32)handle.index / Resource_Pool< T >::page_slot_count;
+    resource_pool->page_live_counts[page_index].fetch_sub(1, std::memory_order_release);
 
-    Resource_Pool_Node *node = (Resource_Pool_Node *)&resource_pool->data[handle.index];
-    node->next = resource_pool->first_free_node_index;
-    resource_pool->first_free_node_index = handle.index;
-    resource_pool->generations[handle.index]++;
-    resource_pool->is_allocated[handle.index] = false;
-    resource_pool->count--;
+    U64 head = resource_pool->free_list_head.load(std::memory_order_relaxed);
 
-    platform_unlock_mutex(&resource_pool->mutex);
+    while (true)
+    {
+        resource_pool->next_free_indices[handle.index].store((S32)(U32)head, std::memory_order_relaxed);
+
+        U64 tag = (head >> 32) + 1;
+        U64 new_head = (tag << 32) | (U32)handle.index;
+
+        if (resource_pool->free_list_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+}
+
+// decommits the slot memory of pages with no live slots, the first empty page is kept so a pool that keeps
+// acquiring and releasing around a page boundary doesn't decommit and recommit it every time.
+// the slots of a decommited page stay in the free list and the page is recommited when one of them is acquired.
+// must not run while another thread reads the slots of handles it didn't check, like iterating with next().
+template< typename T >
+U32 trim(Resource_Pool< T > *resource_pool)
+{
+    HE_ASSERT(resource_pool);
+
+    platform_lock_mutex(&resource_pool->page_mutex);
+    HE_DEFER { platform_unlock_mutex(&resource_pool->page_mutex); };
+
+    U32 page_count = resource_pool->capacity.load(std::memory_order_relaxed) / Resource_Pool< T >::page_slot_count;
+    U32 decommited_page_count = 0;
+    bool kept_empty_page = false;
+
+    for (U32 page_index = 0; page_index < page_count; page_index++)
+    {
+        U32 live_count = resource_pool->page_live_counts[page_index].load(std::memory_order_relaxed);
+        if (live_count)
+        {
+            continue;
+        }
+
+        if (!kept_empty_page)
+        {
+            kept_empty_page = true;
+            continue;
+        }
+
+        U32 expected = 0;
+        if (resource_pool->page_live_counts[page_index].compare_exchange_strong(expected, HE_RESOURCE_POOL_PAGE_DECOMMITED, std::memory_order_acq_rel))
+        {
+            T *page = &resource_pool->data[page_index * Resource_Pool< T >::page_slot_count];
+            bool decommited = platform_decommit_memory(page, sizeof(T) * Resource_Pool< T >::page_slot_count);
+            HE_ASSERT(decommited);
+            decommited_page_count++;
+        }
+    }
+
+    return decommited_page_count;
 }
 
 template< typename T >
@@ -159,18 +377,45 @@ Resource_Handle< T > iterator(Resource_Pool< T > *resource_pool)
     return Resource_Pool< T >::invalid_handle;
 }
 
+// walks the occupancy bits so the cost is a word per 64 slots plus a step per live slot.
+// a slot acquired or released by another thread during the walk may or may not be visited.
 template< typename T >
 bool next(Resource_Pool< T > *resource_pool, Resource_Handle< T > &handle)
 {
-    for (U32 index = handle.index + 1; index < resource_pool->capacity; index++)
+    U32 capacity = resource_pool->capacity.load(std::memory_order_acquire);
+    U32 start_index = (U32)(handle.index + 1);
+    if (start_index >= capacity)
+    {
+        return false;
+    }
+
+    // the last page can be partial, its bits past the capacity are never set.
+    U32 word_count = (capacity + 63) / 64;
+    U32 word_index = start_index / 64;
+    U64 word = resource_pool->occupancy[word_index].load(std::memory_order_acquire) & (~0ull << (start_index % 64));
+
+    while (true)
     {
-        if (resource_pool->is_allocated[index])
+        while (!word)
+        {
+            word_index++;
+            if (word_index == word_count)
+            {
+                return false;
+            }
+            word = resource_pool->occupancy[word_index].load(std::memory_order_acquire);
+        }
+
+        U32 index = word_index * 64 + (U32)_tzcnt_u64(word);
+        word &= word - 1;
+
+        // the bit is set after the generation becomes odd and cleared before it becomes even again.
+        U32 generation = resource_pool->generations[index].load(std::memory_order_acquire);
+        if (generation & 1)
         {
             handle.index = (S32)index;
-            handle.generation = resource_pool->generations[index];
+            handle.generation = generation;
             return true;
         }
     }
-
-    return false;
-}
\ No newline at end of file
+}
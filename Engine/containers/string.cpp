@@ -17,21 +17,6 @@ U64 string_length(const char *str)
     return length;
 }
 
-U64 hash_key(String str)
-{
-    const U64 p = 31;
-    const U64 m = U64(1e9) + 7;
-
-    U64 hash = 0;
-    U64 multiplier = 1;
-    for (U32 i = 0; i < str.count; i++)
-    {
-        hash = ((hash + (str.data[i] - 'a' + 1) * multiplier)) % m;
-        multiplier = (multiplier * p) % m;
-    }
-    return hash;
-}
-
 String copy_string(const char *str, U64 count, Allocator allocator)
 {
     HE_ASSERT(str);
@@ -3,6 +3,13 @@
 #include "core/defines.h"
 #include "core/memory.h"
 
+#include <string.h>
+#include <type_traits>
+
+#if HE_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
 struct String
 {
     U64 count;
@@ -14,7 +21,6 @@ struct String
 #define HE_EXPAND_STRING(string) (U32)((string).count), (string).data
 
 U64 string_length(const char *str);
-U64 hash_key(String str);
 
 template< U64 Count >
 constexpr U64 comptime_string_length(const char(&)[Count])
@@ -22,20 +28,123 @@ constexpr U64 comptime_string_length(const char(&)[Count])
     return Count - 1;
 }
 
-template< U64 Count >
-constexpr U64 comptime_string_hash(const char(&str)[Count])
+// wyhash (final version 4), constexpr so literals can be hashed at compile time with the same result as at runtime.
+constexpr U64 wyhash_secret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+// 64x64 -> 128 bit multiply, low half in a and high half in b.
+HE_FORCE_INLINE constexpr void wyhash_multiply(U64 *a, U64 *b)
+{
+    if (!std::is_constant_evaluated())
+    {
+#if HE_COMPILER_MSVC
+        *a = _umul128(*a, *b, b);
+#else
+        __uint128_t r = (__uint128_t)*a * *b;
+        *a = (U64)r;
+        *b = (U64)(r >> 64);
+#endif
+        return;
+    }
+
+    U64 ha = *a >> 32, hb = *b >> 32, la = (U32)*a, lb = (U32)*b;
+    U64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    U64 t = rl + (rm0 << 32);
+    U64 c = t < rl;
+    U64 low = t + (rm1 << 32);
+    c += low < t;
+    *a = low;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+}
+
+HE_FORCE_INLINE constexpr U64 wyhash_mix(U64 a, U64 b)
 {
-    const U64 p = 31;
-    const U64 m = U64(1e9) + 7;
+    wyhash_multiply(&a, &b);
+    return a ^ b;
+}
 
-    U64 hash = 0;
-    U64 multiplier = 1;
-    for (U32 i = 0; i < Count - 1; i++)
+HE_FORCE_INLINE constexpr U64 wyhash_read(const char *p, U32 count)
+{
+    if (!std::is_constant_evaluated())
     {
-        hash = ((hash + (str[i] - 'a' + 1) * multiplier)) % m;
-        multiplier = (multiplier * p) % m;
+        U64 result = 0;
+        memcpy(&result, p, count);
+        return result;
     }
-    return hash;
+
+    U64 result = 0;
+    for (U32 i = 0; i < count; i++)
+    {
+        result |= (U64)(U8)p[i] << (i * 8);
+    }
+    return result;
+}
+
+constexpr U64 hash_string(const char *data, U64 count, U64 seed = 0)
+{
+    const char *p = data;
+    seed ^= wyhash_mix(seed ^ wyhash_secret[0], wyhash_secret[1]);
+
+    U64 a = 0;
+    U64 b = 0;
+
+    if (count <= 16)
+    {
+        if (count >= 4)
+        {
+            a = (wyhash_read(p, 4) << 32) | wyhash_read(p + ((count >> 3) << 2), 4);
+            b = (wyhash_read(p + count - 4, 4) << 32) | wyhash_read(p + count - 4 - ((count >> 3) << 2), 4);
+        }
+        else if (count > 0)
+        {
+            a = ((U64)(U8)p[0] << 16) | ((U64)(U8)p[count >> 1] << 8) | (U64)(U8)p[count - 1];
+        }
+    }
+    else
+    {
+        U64 i = count;
+        if (i > 48)
+        {
+            U64 see1 = seed;
+            U64 see2 = seed;
+            do
+            {
+                seed = wyhash_mix(wyhash_read(p, 8) ^ wyhash_secret[1], wyhash_read(p + 8, 8) ^ seed);
+                see1 = wyhash_mix(wyhash_read(p + 16, 8) ^ wyhash_secret[2], wyhash_read(p + 24, 8) ^ see1);
+                see2 = wyhash_mix(wyhash_read(p + 32, 8) ^ wyhash_secret[3], wyhash_read(p + 40, 8) ^ see2);
+                p += 48;
+                i -= 48;
+            }
+            while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16)
+        {
+            seed = wyhash_mix(wyhash_read(p, 8) ^ wyhash_secret[1], wyhash_read(p + 8, 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = wyhash_read(p + i - 16, 8);
+        b = wyhash_read(p + i - 8, 8);
+    }
+
+    a ^= wyhash_secret[1];
+    b ^= seed;
+
+    wyhash_multiply(&a, &b);
+    return wyhash_mix(a ^ wyhash_secret[0] ^ count, b ^ wyhash_secret[1]);
+}
+
+HE_FORCE_INLINE U64 hash_key(String str)
+{
+    return hash_string(str.data, str.count);
+}
+
+template< U64 Count >
+constexpr U64 comptime_string_hash(const char(&str)[Count])
+{
+    return hash_string(str, Count - 1);
 }
 
 String copy_string(const char *str, U64 count, Allocator allocator = {});
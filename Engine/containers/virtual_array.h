@@ -0,0 +1,231 @@
+#pragma once
+
+#include "core/defines.h"
+#include "core/memory.h"
+#include "core/platform.h"
+
+#include "containers/array_view.h"
+
+// pages are commited and decommited in steps of this size.
+#define HE_VIRTUAL_ARRAY_COMMIT_SIZE HE_KILO_BYTES(64)
+
+// reserves the address space for max_count elements up front and commits it as the array grows,
+// elements never move so pointers into the array stay valid until the elements are removed.
+template< typename T >
+struct Virtual_Array
+{
+    T *data;
+    U32 count;
+    U32 capacity; // elements that fit in the commited memory.
+    U32 max_count;
+    U64 commited_size;
+
+    HE_FORCE_INLINE T& operator[](U32 index)
+    {
+        HE_ASSERT(this);
+        HE_ASSERT(index < count);
+        return data[index];
+    }
+
+    HE_FORCE_INLINE const T& operator[](U32 index) const
+    {
+        HE_ASSERT(this);
+        HE_ASSERT(index < count);
+        return data[index];
+    }
+
+    HE_FORCE_INLINE T* begin()
+    {
+        return &data[0];
+    }
+
+    HE_FORCE_INLINE T* end()
+    {
+        return &data[count];
+    }
+
+    HE_FORCE_INLINE const T* begin() const
+    {
+        return &data[0];
+    }
+
+    HE_FORCE_INLINE const T* end() const
+    {
+        return &data[count];
+    }
+};
+
+template< typename T >
+bool init(Virtual_Array< T > *virtual_array, U32 max_count)
+{
+    HE_ASSERT(virtual_array);
+    HE_ASSERT(max_count);
+
+    U64 reserve_size = (sizeof(T) * max_count + HE_VIRTUAL_ARRAY_COMMIT_SIZE - 1) & ~(HE_VIRTUAL_ARRAY_COMMIT_SIZE - 1);
+    void *memory = platform_reserve_memory(reserve_size);
+    if (!memory)
+    {
+        return false;
+    }
+
+    virtual_array->data = (T *)memory;
+    virtual_array->count = 0;
+    virtual_array->capacity = 0;
+    virtual_array->max_count = max_count;
+    virtual_array->commited_size = 0;
+    return true;
+}
+
+template< typename T >
+void deinit(Virtual_Array< T > *virtual_array)
+{
+    HE_ASSERT(virtual_array);
+
+    if (virtual_array->data)
+    {
+        platform_deallocate_memory(virtual_array->data);
+        virtual_array->data = nullptr;
+    }
+
+    virtual_array->count = 0;
+    virtual_array->capacity = 0;
+    virtual_array->commited_size = 0;
+}
+
+// commits or decommits memory so that it covers new_capacity elements, decommited pages read back as zeros.
+template< typename T >
+void set_capacity(Virtual_Array< T > *virtual_array, U32 new_capacity)
+{
+    HE_ASSERT(virtual_array);
+    HE_ASSERT(virtual_array->data);
+    HE_ASSERT(new_capacity <= virtual_array->max_count);
+    HE_ASSERT(new_capacity >= virtual_array->count);
+
+    U64 commited_size = (sizeof(T) * new_capacity + HE_VIRTUAL_ARRAY_COMMIT_SIZE - 1) & ~(HE_VIRTUAL_ARRAY_COMMIT_SIZE - 1);
+    U8 *base = (U8 *)virtual_array->data;
+
+    if (commited_size > virtual_array->commited_size)
+    {
+        bool commited = platform_commit_memory(base + virtual_array->commited_size, commited_size - virtual_array->commited_size);
+        HE_ASSERT(commited);
+    }
+    else if (commited_size < virtual_array->commited_size)
+    {
+        bool decommited = platform_decommit_memory(base + commited_size, virtual_array->commited_size - commited_size);
+        HE_ASSERT(decommited);
+    }
+
+    virtual_array->commited_size = commited_size;
+    virtual_array->capacity = (U32)HE_MIN(commited_size / sizeof(T), (U64)virtual_array->max_count);
+}
+
+// grows the commit as needed, shrinking decommits the pages past the new count.
+template< typename T >
+void set_count(Virtual_Array< T > *virtual_array, U32 new_count)
+{
+    HE_ASSERT(virtual_array);
+
+    U32 count = virtual_array->count;
+    virtual_array->count = new_count;
+
+    if (new_count > virtual_array->capacity || new_count < count)
+    {
+        set_capacity(virtual_array, new_count);
+    }
+}
+
+// keeps the commited memory for reuse, see set_count to give it back.
+template< typename T >
+void reset(Virtual_Array< T > *virtual_array)
+{
+    HE_ASSERT(virtual_array);
+    virtual_array->count = 0;
+}
+
+template< typename T >
+void append(Virtual_Array< T > *virtual_array, const T &item)
+{
+    HE_ASSERT(virtual_array);
+
+    if (virtual_array->count == virtual_array->capacity)
+    {
+        set_capacity(virtual_array, virtual_array->count + 1);
+    }
+    virtual_array->data[virtual_array->count++] = item;
+}
+
+template< typename T >
+T& append(Virtual_Array< T > *virtual_array)
+{
+    HE_ASSERT(virtual_array);
+
+    if (virtual_array->count == virtual_array->capacity)
+    {
+        set_capacity(virtual_array, virtual_array->count + 1);
+    }
+    return virtual_array->data[virtual_array->count++];
+}
+
+template< typename T >
+U32 index_of(Virtual_Array< T > *virtual_array, const T &item)
+{
+    HE_ASSERT(virtual_array);
+    S64 index = &item - virtual_array->data;
+    HE_ASSERT(index >= 0 && index < virtual_array->count);
+    return (U32)index;
+}
+
+template< typename T >
+void remove_back(Virtual_Array< T > *virtual_array)
+{
+    HE_ASSERT(virtual_array);
+    HE_ASSERT(virtual_array->count > 0);
+    virtual_array->count--;
+}
+
+template< typename T >
+void remove_and_swap_back(Virtual_Array< T > *virtual_array, U32 index)
+{
+    HE_ASSERT(virtual_array);
+    HE_ASSERT(index < virtual_array->count);
+    virtual_array->data[index] = virtual_array->data[virtual_array->count - 1];
+    virtual_array->count--;
+}
+
+template< typename T >
+HE_FORCE_INLINE T& front(Virtual_Array< T > *virtual_array)
+{
+    HE_ASSERT(virtual_array);
+    HE_ASSERT(virtual_array->count);
+    return virtual_array->data[0];
+}
+
+template< typename T >
+HE_FORCE_INLINE T& back(Virtual_Array< T > *virtual_array)
+{
+    HE_ASSERT(virtual_array);
+    HE_ASSERT(virtual_array->count);
+    return virtual_array->data[virtual_array->count - 1];
+}
+
+template< typename T >
+S32 find(const Virtual_Array< T > *virtual_array, const T &target)
+{
+    HE_ASSERT(virtual_array);
+
+    for (S32 index = 0; index < (S32)virtual_array->count; index++)
+    {
+        if (virtual_array->data[index] == target)
+        {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+template< typename T >
+HE_FORCE_INLINE Array_View< T > to_array_view(const Virtual_Array< T > &array)
+{
+    return { array.count, array.data };
+}
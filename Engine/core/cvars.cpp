@@ -2,8 +2,10 @@
 #include "platform.h"
 #include "memory.h"
 #include "file_system.h"
+#include "name.h"
 #include "containers/string.h"
 #include "containers/dynamic_array.h"
+#include "containers/hash_map.h"
 
 #include <stdlib.h>
 
@@ -23,35 +25,36 @@ struct CVar_Category
 {
     String name;
     Dynamic_Array< CVar > vars;
+    Hash_Map< Name, U32 > var_indices;
 };
 
 struct CVars_State
 {
     String filepath;
     Dynamic_Array< CVar_Category > categories;
+    Hash_Map< Name, U32 > category_indices;
 };
 
 static CVars_State cvars_state;
 
 static CVar_Category* find_or_append_category(const String &name, bool should_append = true)
 {
-    Memory_Context memory_context = grab_memory_context();
-
     auto &categories = cvars_state.categories;
 
-    for (U32 category_index = 0; category_index < categories.count; category_index++)
+    Name category_name = should_append ? make_name(name) : find_name(name);
+
+    auto it = find(&cvars_state.category_indices, category_name);
+    if (is_valid(it))
     {
-        if (categories[category_index].name == name)
-        {
-            return &categories[category_index];
-        }
+        return &categories[*it.value];
     }
 
     if (should_append)
     {
         CVar_Category category = {};
-        category.name = copy_string(name, memory_context.permenent_allocator);
-        
+        category.name = name_to_string(category_name);
+
+        insert(&cvars_state.category_indices, category_name, categories.count);
         append(&categories, category);
         return &back(&categories);
     }
@@ -61,22 +64,22 @@ static CVar_Category* find_or_append_category(const String &name, bool should_ap
 
 static CVar* find_or_append_cvar(CVar_Category *category, const String &name, bool should_append = true)
 {
-    Memory_Context memory_context = grab_memory_context();
-
     auto &vars = category->vars;
 
-    for (U32 var_index = 0; var_index < vars.count; var_index++)
+    Name var_name = should_append ? make_name(name) : find_name(name);
+
+    auto it = find(&category->var_indices, var_name);
+    if (is_valid(it))
     {
-        if (vars[var_index].name == name)
-        {
-            return &vars[var_index];
-        }
+        return &vars[*it.value];
     }
 
     if (should_append)
     {
         CVar var = {};
-        var.name = copy_string(name, memory_context.permenent_allocator);
+        var.name = name_to_string(var_name);
+
+        insert(&category->var_indices, var_name, vars.count);
         append(&vars, var);
         return &back(&vars);
     }
@@ -6,6 +6,7 @@
 #include "cvars.h"
 #include "job_system.h"
 #include "file_system.h"
+#include "name.h"
 
 // #include "resources/resource_system.h"
 #include "assets/asset_manager.h"
@@ -28,9 +29,16 @@ bool startup(Engine *engine)
         return false;
     }
 
+    bool names_inited = init_names();
+    if (!names_inited)
+    {
+        return false;
+    }
+
     init_logging_system();
     
     init_cvars(HE_STRING_LITERAL("config.cvars"));
+    declare_memory_cvars();
     
     engine->show_cursor = false;
     engine->lock_cursor = false;
@@ -130,6 +138,7 @@ void game_loop(Engine *engine, F32 delta_time)
     hope_app_on_update(engine, delta_time);
 
     end_temprary_memory(frame_temprary_memory);
+    update_memory_stats();
 }
 
 void shutdown(Engine *engine)
@@ -146,5 +155,7 @@ void shutdown(Engine *engine)
 
     deinit_logging_system();
 
+    deinit_names();
+
     deinit_memory_system();
 }
\ No newline at end of file
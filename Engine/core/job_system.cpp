@@ -5,221 +5,660 @@
 #include "memory.h"
 #include "logging.h"
 #include "file_system.h"
+#include "cvars.h"
 
 #include "containers/queue.h"
+#include "containers/counted_array.h"
 
 #include <atomic>
+#include <algorithm>
+#include <immintrin.h>
 
 #define JOB_COUNT_PER_THREAD 4096
+#define JOB_WAIT_SPIN_COUNT 64
+#define JOB_STEALABLE_PRIORITY_COUNT 2
+#define JOB_TRACE_EVENT_COUNT_PER_THREAD 16384
+
+static_assert((U32)Job_Priority::NORMAL < JOB_STEALABLE_PRIORITY_COUNT && (U32)Job_Priority::HIGH < JOB_STEALABLE_PRIORITY_COUNT);
+
+enum class Job_Thread_Policy : U32
+{
+    LOGICAL_PROCESSORS, // one thread per logical processor.
+    PHYSICAL_CORES,     // one thread per physical core, smt siblings are left idle.
+    EXPLICIT_MASK,      // one thread per bit set in affinity_mask.
+};
+
+enum class Job_Trace_Event_Type : U8
+{
+    JOB,
+    SLEEP, // waiting for the worker group semaphore.
+    WAIT,  // blocked on a job or a counter.
+};
+
+struct Job_Trace_Event
+{
+    const char *name;
+    U64 id;
+    U64 parent_id; // the job that scheduled this job, either by submitting it or by finishing its last dependency.
+    U64 ready_time;
+    U64 begin_time;
+    U64 end_time;
+    Job_Trace_Event_Type type;
+};
+
+// written only by the owning thread, read by dump_job_trace.
+struct Job_Trace_Buffer
+{
+    Job_Trace_Event *events;
+    std::atomic< U64 > write_index;
+};
+
+struct Worker_Group
+{
+    Semaphore wake_semaphore;
+    std::atomic< U32 > sleeping_thread_count;
+};
 
 struct Thread_State
 {
     Memory_Arena *arena;
     U32 thread_index;
+    U32 random_state;
     Thread thread;
 
-    Semaphore job_queue_semaphore;
-    Mutex job_queue_mutex;
-    Mutex dependency_mutex;
+    Worker_Group *group;
+    bool prefers_background_jobs;
+    bool can_run_background_jobs;
 
-    Ring_Queue< Job_Handle > job_queue;
+    // indexed by Job_Priority, background jobs go to the shared background queue.
+    Work_Stealing_Queue< Job_Handle > job_queues[JOB_STEALABLE_PRIORITY_COUNT];
+
+    Job_Trace_Buffer trace_buffer;
+    U64 current_trace_id; // trace id of the job running on this thread.
 };
 
 struct Job_System_State
 {
     std::atomic< bool > running;
     std::atomic< U32 > in_progress_job_count;
+    std::atomic< U32 > waiting_thread_count;
+
+    Worker_Group worker_group;
+    Worker_Group background_group;
 
     Free_List_Allocator job_data_allocator;
+    Slab_Allocator job_slab_allocator; // parameters, wait nodes and coroutine frames, falls back to job_data_allocator.
+
+    U32 thread_policy;
+    U32 reserved_processor_count; // processors left for the main thread and the os, ignored by EXPLICIT_MASK.
+    U64 affinity_mask;
+    bool pin_threads;
+
+    bool trace_jobs; // the cvar, only read at init since the trace buffers are allocated there.
+    bool tracing;
+    std::atomic< U64 > next_trace_id;
 
     U32 thread_count;
-    Thread_State *thread_states;
+    U32 background_thread_count;
+    Thread_State *thread_states; // worker threads, background threads then the main thread.
+
+    // jobs submitted from threads that doesn't own a queue (file watcher) or when a local queue is full.
+    MPMC_Queue< Job_Handle > global_job_queue;
+
+    // long running jobs (file io, asset loading) are kept away from the worker queues so they never delay frame work.
+    MPMC_Queue< Job_Handle > background_job_queue;
 
     Resource_Pool< Job > job_pool;
 };
 
 static Job_System_State job_system_state;
+static Job_Wait_Node closed_wait_list; // marks the wait list of a finished job.
 
-static void schedule_job_to_least_worked_thread(Job_Handle job_handle)
+// wait nodes are 8 byte aligned user space addresses so the pointer fits in the low 44 bits of a wait list head.
+#define JOB_WAIT_LIST_TAG_SHIFT 44
+
+HE_FORCE_INLINE static U64 make_wait_list_head(Job_Wait_Node *wait_node, U32 generation)
 {
-    Thread_State *least_worked_thread_state = nullptr;
-    U32 least_worked_thread_index = 0;
-    U32 least_work_count_so_far = HE_MAX_U32;
+    U64 address = (U64)wait_node;
+    HE_ASSERT((address & 7) == 0 && address < (1ull << (JOB_WAIT_LIST_TAG_SHIFT + 3)));
 
-    for (U32 thread_index = 0; thread_index < job_system_state.thread_count; thread_index++)
-    {
-        Thread_State *thread_state = &job_system_state.thread_states[thread_index];
+    // generations of live jobs are odd so the tag is never zero like the head of a slot acquire_handle just cleared.
+    U64 tag = generation & ((1ull << (64 - JOB_WAIT_LIST_TAG_SHIFT)) - 1);
+    return (address >> 3) | (tag << JOB_WAIT_LIST_TAG_SHIFT);
+}
 
-        platform_lock_mutex(&thread_state->job_queue_mutex);
-        U32 job_count_in_queue = count(&thread_state->job_queue);
-        if (job_count_in_queue < least_work_count_so_far)
-        {
-            least_worked_thread_index = thread_index;
-            least_worked_thread_state = thread_state;
-            least_work_count_so_far = job_count_in_queue;
-        }
-        platform_unlock_mutex(&thread_state->job_queue_mutex);
+HE_FORCE_INLINE static Job_Wait_Node* get_wait_list_node(U64 head)
+{
+    return (Job_Wait_Node *)((head & ((1ull << JOB_WAIT_LIST_TAG_SHIFT) - 1)) << 3);
+}
+
+HE_FORCE_INLINE static bool is_valid_job_handle(Job_Handle job_handle)
+{
+    return is_valid_handle(&job_system_state.job_pool, job_handle);
+}
+
+HE_FORCE_INLINE static Job* get_job(Job_Handle job_handle)
+{
+    return get(&job_system_state.job_pool, job_handle);
+}
+
+static void record_trace_event(Thread_State *thread_state, const Job_Trace_Event &event)
+{
+    Job_Trace_Buffer *trace_buffer = &thread_state->trace_buffer;
+    if (!trace_buffer->events)
+    {
+        return;
     }
 
-    HE_ASSERT(least_worked_thread_state);
+    U64 write_index = trace_buffer->write_index.load(std::memory_order_relaxed);
+    trace_buffer->events[write_index & (JOB_TRACE_EVENT_COUNT_PER_THREAD - 1)] = event;
+    trace_buffer->write_index.store(write_index + 1, std::memory_order_release);
+}
 
-    platform_lock_mutex(&least_worked_thread_state->job_queue_mutex);
-    S32 index = push(&least_worked_thread_state->job_queue, job_handle);
-    HE_ASSERT(index != -1);
-    platform_unlock_mutex(&least_worked_thread_state->job_queue_mutex);
+static thread_local Thread_State *current_thread_state = nullptr;
 
-    bool signaled = platform_signal_semaphore(&least_worked_thread_state->job_queue_semaphore);
-    HE_ASSERT(signaled);
+static void decrement_counter(std::atomic< U32 > *counter, U32 amount);
+
+static void wake_sleeping_threads(Worker_Group *group, U32 job_count)
+{
+    // pairs with the sleeping_thread_count increment in execute_thread_work so a job pushed right before a worker goes to sleep is never missed.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    U32 sleeping_thread_count = group->sleeping_thread_count.load(std::memory_order_relaxed);
+    if (sleeping_thread_count)
+    {
+        bool signaled = platform_signal_semaphore(&group->wake_semaphore, HE_MIN(job_count, sleeping_thread_count));
+        HE_ASSERT(signaled);
+    }
 }
 
-static void terminate_job(Job_Handle job_handle)
+static Worker_Group* enqueue_job(Job_Handle job_handle, Job_Priority priority)
 {
-    job_system_state.in_progress_job_count.fetch_sub(1);
+    // stamped before the push, the job can run and be released as soon as it is in a queue.
+    if (job_system_state.tracing)
+    {
+        Job *job = get_job(job_handle);
+        job->trace_ready_time = platform_get_performance_counter();
+        job->trace_parent_id = current_thread_state ? current_thread_state->current_trace_id : 0;
+    }
+
+    if (priority == Job_Priority::BACKGROUND)
+    {
+        bool pushed = push(&job_system_state.background_job_queue, job_handle);
+        HE_ASSERT(pushed);
+        return job_system_state.background_thread_count ? &job_system_state.background_group : &job_system_state.worker_group;
+    }
 
-    Job *job = get(&job_system_state.job_pool, job_handle);
+    Thread_State *thread_state = current_thread_state;
 
-    for (Job_Ref dependent_job_ref : job->dependent_jobs)
+    bool pushed = false;
+    if (thread_state)
     {
-        Job_Handle dependent_job_handle = { .index = dependent_job_ref.index, .generation = dependent_job_ref.generation };
-        if (is_valid_handle(&job_system_state.job_pool, dependent_job_handle))
-        {
-            terminate_job(dependent_job_handle);
-        }
+        pushed = push(&thread_state->job_queues[(U32)priority], job_handle);
     }
 
-    release_handle(&job_system_state.job_pool, job_handle);
+    if (!pushed)
+    {
+        pushed = push(&job_system_state.global_job_queue, job_handle);
+        HE_ASSERT(pushed);
+    }
+
+    return &job_system_state.worker_group;
 }
 
-static void finalize_job(Job_Handle job_handle, Job_Result result)
+static void schedule_job(Job_Handle job_handle, Job_Priority priority)
 {
-    Job *job = get(&job_system_state.job_pool, job_handle);
-    platform_lock_mutex(&job->dependent_jobs_mutex);
+    Worker_Group *group = enqueue_job(job_handle, priority);
+    wake_sleeping_threads(group, 1);
+}
 
-    std::atomic_store((std::atomic<bool>*)&job->finished, true);
+static U32 next_random(Thread_State *thread_state)
+{
+    // xorshift32
+    U32 x = thread_state->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    thread_state->random_state = x;
+    return x;
+}
 
-    for (Job_Ref job_ref : job->dependent_jobs)
+static bool find_job(Thread_State *thread_state, Job_Handle *out_job_handle)
+{
+    MPMC_Queue< Job_Handle > *background_job_queue = &job_system_state.background_job_queue;
+
+    if (thread_state->prefers_background_jobs && pop(background_job_queue, out_job_handle))
+    {
+        return true;
+    }
+
+    static constexpr Job_Priority priorities[] = { Job_Priority::HIGH, Job_Priority::NORMAL };
+
+    for (Job_Priority priority : priorities)
     {
-        Job_Handle dependent_job_handle = { job_ref.index, job_ref.generation };
-        if (!is_valid_handle(&job_system_state.job_pool, dependent_job_handle))
+        U32 queue_index = (U32)priority;
+
+        if (pop(&thread_state->job_queues[queue_index], out_job_handle))
         {
-            continue;
+            return true;
         }
 
-        Job *dependent_job = get(&job_system_state.job_pool, dependent_job_handle);
+        U32 queue_count = job_system_state.thread_count + 1;
+        U32 victim_index = next_random(thread_state) % queue_count;
 
-        if (result == Job_Result::SUCCEEDED)
+        for (U32 attempt = 0; attempt < queue_count; attempt++)
         {
-            U32 old_value = std::atomic_fetch_sub((std::atomic<U32>*)&dependent_job->remaining_job_count, 1);
-            if (old_value == 1)
+            Thread_State *victim_state = &job_system_state.thread_states[victim_index];
+            if (victim_state != thread_state && steal(&victim_state->job_queues[queue_index], out_job_handle))
             {
-                schedule_job_to_least_worked_thread(dependent_job_handle);
+                return true;
+            }
+
+            victim_index++;
+            if (victim_index == queue_count)
+            {
+                victim_index = 0;
             }
-        }
-        else
-        {
-            terminate_job(dependent_job_handle);
         }
     }
 
-    reset(&job->dependent_jobs);
+    if (pop(&job_system_state.global_job_queue, out_job_handle))
+    {
+        return true;
+    }
 
-    platform_unlock_mutex(&job->dependent_jobs_mutex);
+    if (thread_state->can_run_background_jobs && !thread_state->prefers_background_jobs)
+    {
+        return pop(background_job_queue, out_job_handle);
+    }
 
-    deallocate(&job_system_state.job_data_allocator, job->data.parameters.data);
+    return false;
+}
 
+static void release_job(Job_Handle job_handle)
+{
     release_handle(&job_system_state.job_pool, job_handle);
+
+    // waiters sleep on the generation of the slot, see wait_for_job_to_finish.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (job_system_state.waiting_thread_count.load(std::memory_order_relaxed))
+    {
+        platform_wake_all_on_address(&job_system_state.job_pool.generations[job_handle.index]);
+    }
+}
+
+static void finalize_job(Job_Handle job_handle, Job_Result result);
+
+// aborted jobs are finalized without running so the jobs waiting on them see the failure.
+static void terminate_job(Job_Handle job_handle)
+{
+    finalize_job(job_handle, Job_Result::ABORTED);
+    decrement_counter(&job_system_state.in_progress_job_count, 1);
+}
+
+// schedules the job once everything it waits for finished, or terminates it if one of them failed.
+static void satisfy_job_dependencies(Job_Handle job_handle, U32 count)
+{
+    Job *job = get_job(job_handle);
+
+    if (job->remaining_job_count.fetch_sub(count, std::memory_order_acq_rel) != count)
+    {
+        return;
+    }
+
+    if (job->dependency_failed.load(std::memory_order_relaxed) && !job->is_continuation)
+    {
+        terminate_job(job_handle);
+    }
+    else
+    {
+        schedule_job(job_handle, job->data.priority);
+    }
+}
+
+static void notify_waiting_job(Job_Handle waiting_job_handle, bool succeeded)
+{
+    if (!succeeded)
+    {
+        Job *waiting_job = get_job(waiting_job_handle);
+        waiting_job->dependency_failed.store(true, std::memory_order_relaxed);
+    }
+
+    satisfy_job_dependencies(waiting_job_handle, 1);
+}
+
+static void finalize_job(Job_Handle job_handle, Job_Result result)
+{
+    Job *job = get_job(job_handle);
+
+    // jobs that try to wait on this job after the list is closed don't wait at all, see submit_job.
+    U64 head = job->waiting_jobs.exchange(make_wait_list_head(&closed_wait_list, job_handle.generation), std::memory_order_acq_rel);
+    Job_Wait_Node *wait_node = get_wait_list_node(head);
+
+    while (wait_node)
+    {
+        // the node lives in the waiting job which can be released as soon as it is notified.
+        Job_Wait_Node *next_wait_node = wait_node->next;
+        notify_waiting_job(wait_node->job_handle, result == Job_Result::SUCCEEDED);
+        wait_node = next_wait_node;
+    }
+
+    Job_Handle signal_counter = job->data.signal_counter;
+    if (signal_counter.index != -1)
+    {
+        decrement_job_counter(signal_counter, 1, result);
+    }
+
+    if (job->data.parameters.data != job->inline_data)
+    {
+        deallocate(&job_system_state.job_slab_allocator, job->data.parameters.data);
+    }
+    deallocate(&job_system_state.job_slab_allocator, job->overflow_wait_nodes);
+
+    release_job(job_handle);
+}
+
+static void run_job(Thread_State *thread_state, Job_Handle job_handle)
+{
+    Job *job = get_job(job_handle);
+    HE_ASSERT(job->data.proc);
+
+    bool trace_jobs = job_system_state.tracing;
+    U64 previous_trace_id = thread_state->current_trace_id;
+
+    Job_Trace_Event trace_event = {};
+    if (trace_jobs)
+    {
+        trace_event.name = job->data.name ? job->data.name : "job";
+        trace_event.id = job->trace_id;
+        trace_event.parent_id = job->trace_parent_id;
+        trace_event.ready_time = job->trace_ready_time;
+        trace_event.type = Job_Trace_Event_Type::JOB;
+        trace_event.begin_time = platform_get_performance_counter();
+        thread_state->current_trace_id = job->trace_id;
+    }
+
+    Temprary_Memory temprary_memory = begin_temprary_memory(thread_state->arena);
+    job->data.parameters.arena = thread_state->arena;
+
+    Job_Result result = job->data.proc(job->data.parameters);
+    if (job->data.completed_proc)
+    {
+        job->data.completed_proc(result);
+    }
+
+    end_temprary_memory(temprary_memory);
+
+    if (trace_jobs)
+    {
+        trace_event.end_time = platform_get_performance_counter();
+        record_trace_event(thread_state, trace_event);
+    }
+
+    // the jobs this one makes ready are traced as its children.
+    finalize_job(job_handle, result);
+
+    thread_state->current_trace_id = previous_trace_id;
+
+    decrement_counter(&job_system_state.in_progress_job_count, 1);
 }
 
 unsigned long execute_thread_work(void *params)
 {
     Thread_State *thread_state = (Thread_State *)params;
-    Semaphore *job_queue_semaphore = &thread_state->job_queue_semaphore;
-    Mutex *job_queue_mutex = &thread_state->job_queue_mutex;
-    Mutex *dependency_mutex = &thread_state->dependency_mutex;
-    Ring_Queue< Job_Handle > *job_queue = &thread_state->job_queue;
+    Worker_Group *group = thread_state->group;
+    current_thread_state = thread_state;
+
+    Thread_Context *thread_context = register_thread_context();
+    HE_ASSERT(thread_context);
+    thread_state->arena = &thread_context->arena;
 
     while (true)
     {
-        bool signaled = platform_wait_for_semaphore(job_queue_semaphore);
-        HE_ASSERT(signaled);
+        Job_Handle job_handle = Resource_Pool< Job >::invalid_handle;
+
+        if (find_job(thread_state, &job_handle))
+        {
+            run_job(thread_state, job_handle);
+            continue;
+        }
+
+        group->sleeping_thread_count.fetch_add(1);
 
-        platform_lock_mutex(job_queue_mutex);
+        // check again after announcing that we are going to sleep, see wake_sleeping_threads.
+        if (find_job(thread_state, &job_handle))
+        {
+            group->sleeping_thread_count.fetch_sub(1);
+            run_job(thread_state, job_handle);
+            continue;
+        }
 
-        if (!job_system_state.running && count(job_queue) == 0)
+        if (!job_system_state.running)
         {
-            platform_unlock_mutex(job_queue_mutex);
+            group->sleeping_thread_count.fetch_sub(1);
             break;
         }
 
-        U32 index = 0;
-        Job_Handle job_handle = Resource_Pool<Job>::invalid_handle;
-        bool peeked = peek_front(job_queue, &job_handle, &index);
-        Job *job = get(&job_system_state.job_pool, job_handle);
-        platform_unlock_mutex(job_queue_mutex);
+        U64 sleep_begin_time = job_system_state.tracing ? platform_get_performance_counter() : 0;
+
+        bool signaled = platform_wait_for_semaphore(&group->wake_semaphore);
+        HE_ASSERT(signaled);
+
+        if (job_system_state.tracing)
+        {
+            record_trace_event(thread_state, { .name = "sleep", .begin_time = sleep_begin_time, .end_time = platform_get_performance_counter(), .type = Job_Trace_Event_Type::SLEEP });
+        }
+
+        group->sleeping_thread_count.fetch_sub(1);
+    }
+
+    return 0;
+}
+
+// fills the logical processors the job threads run on in thread index order, workers take the front of the list
+// and background threads the back. returns false if the topology is unknown and the threads shouldn't be pinned.
+static bool get_job_thread_processors(Counted_Array< U8, HE_MAX_PROCESSOR_CORE_COUNT > *processors)
+{
+    Processor_Topology topology;
+    if (!platform_get_processor_topology(&topology))
+    {
+        U32 logical_processor_count = HE_MIN(platform_get_thread_count(), (U32)HE_MAX_PROCESSOR_CORE_COUNT);
+        for (U32 processor_index = 0; processor_index < logical_processor_count; processor_index++)
+        {
+            append(processors, (U8)processor_index);
+        }
+        return false;
+    }
 
-        HE_ASSERT(peeked);
-        HE_ASSERT(job->data.proc);
+    Job_Thread_Policy policy = (Job_Thread_Policy)job_system_state.thread_policy;
 
-        Temprary_Memory temprary_memory = begin_temprary_memory(thread_state->arena);
-        job->data.parameters.arena = thread_state->arena;
+    if (policy == Job_Thread_Policy::EXPLICIT_MASK)
+    {
+        for (U32 core_index = 0; core_index < topology.core_count; core_index++)
+        {
+            U64 mask = topology.cores[core_index].logical_processor_mask & job_system_state.affinity_mask;
+            for (; mask; mask &= mask - 1)
+            {
+                append(processors, (U8)_tzcnt_u64(mask));
+            }
+        }
 
-        Job_Result result = job->data.proc(job->data.parameters);
-        if (job->data.completed_proc)
+        if (processors->count)
         {
-            job->data.completed_proc(result);
+            return true;
         }
 
-        end_temprary_memory(temprary_memory);
+        HE_LOG(Core, Warn, "job_system -- affinity_mask doesn't contain any available processor, falling back to logical processors\n");
+        policy = Job_Thread_Policy::LOGICAL_PROCESSORS;
+    }
 
-        pop_front(job_queue);
+    // fast cores first, cores sharing a cache next to each other.
+    U32 core_order[HE_MAX_PROCESSOR_CORE_COUNT];
+    for (U32 core_index = 0; core_index < topology.core_count; core_index++)
+    {
+        core_order[core_index] = core_index;
+    }
 
-        finalize_job(job_handle, result);
+    std::stable_sort(core_order, core_order + topology.core_count, [&topology](U32 a, U32 b)
+    {
+        const Processor_Core &a_core = topology.cores[a];
+        const Processor_Core &b_core = topology.cores[b];
+        if (a_core.efficiency_class != b_core.efficiency_class)
+        {
+            return a_core.efficiency_class > b_core.efficiency_class;
+        }
+        return a_core.cache_domain_index < b_core.cache_domain_index;
+    });
 
-        job_system_state.in_progress_job_count.fetch_sub(1);
+    // one processor per core before any smt sibling.
+    U64 remaining_masks[HE_MAX_PROCESSOR_CORE_COUNT];
+    for (U32 order_index = 0; order_index < topology.core_count; order_index++)
+    {
+        U64 mask = topology.cores[core_order[order_index]].logical_processor_mask;
+        append(processors, (U8)_tzcnt_u64(mask));
+        remaining_masks[order_index] = mask & (mask - 1);
     }
 
-    return 0;
+    if (policy == Job_Thread_Policy::LOGICAL_PROCESSORS)
+    {
+        for (U32 order_index = 0; order_index < topology.core_count; order_index++)
+        {
+            for (U64 mask = remaining_masks[order_index]; mask; mask &= mask - 1)
+            {
+                append(processors, (U8)_tzcnt_u64(mask));
+            }
+        }
+    }
+
+    U32 reserved_count = HE_MIN(job_system_state.reserved_processor_count, processors->count - 1);
+    for (U32 processor_index = reserved_count; processor_index < processors->count; processor_index++)
+    {
+        processors->data[processor_index - reserved_count] = processors->data[processor_index];
+    }
+    processors->count -= reserved_count;
+
+    return true;
+}
+
+static void init_worker_group(Worker_Group *group)
+{
+    bool wake_semaphore_created = platform_create_semaphore(&group->wake_semaphore);
+    HE_ASSERT(wake_semaphore_created);
+    group->sleeping_thread_count.store(0);
 }
 
 bool init_job_system()
 {
     Memory_Context memory_context = grab_memory_context();
 
-    bool inited = init_free_list_allocator(&job_system_state.job_data_allocator, nullptr, HE_MEGA_BYTES(64), HE_MEGA_BYTES(64), "job_allocator");
+    bool inited = init_free_list_allocator(&job_system_state.job_data_allocator, nullptr, HE_MEGA_BYTES(64), HE_MEGA_BYTES(64), "job_allocator", true);
+    HE_ASSERT(inited);
+
+    inited = init_slab_allocator(&job_system_state.job_slab_allocator, HE_MEGA_BYTES(256), to_allocator(&job_system_state.job_data_allocator, Memory_Tag::JOBS), SlabAllocatorFlag_ThreadCaches, "job_slab_allocator");
     HE_ASSERT(inited);
 
-    U32 thread_count = get_job_thread_count();
+    U32 &thread_policy = job_system_state.thread_policy;
+    U32 &reserved_processor_count = job_system_state.reserved_processor_count;
+    U64 &affinity_mask = job_system_state.affinity_mask;
+    bool &pin_threads = job_system_state.pin_threads;
+
+    thread_policy = (U32)Job_Thread_Policy::LOGICAL_PROCESSORS;
+    reserved_processor_count = 2;
+    affinity_mask = 0;
+    pin_threads = true;
+
+    HE_DECLARE_CVAR("job_system", thread_policy, CVarFlag_None);
+    HE_DECLARE_CVAR("job_system", reserved_processor_count, CVarFlag_None);
+    HE_DECLARE_CVAR("job_system", affinity_mask, CVarFlag_None);
+    HE_DECLARE_CVAR("job_system", pin_threads, CVarFlag_None);
+
+    bool &trace_jobs = job_system_state.trace_jobs;
+    trace_jobs = false;
+    HE_DECLARE_CVAR("job_system", trace_jobs, CVarFlag_None);
+    job_system_state.tracing = trace_jobs;
+    job_system_state.next_trace_id.store(0);
+
+    Counted_Array< U8, HE_MAX_PROCESSOR_CORE_COUNT > processors = {};
+    bool topology_known = get_job_thread_processors(&processors);
+    if (!topology_known)
+    {
+        U32 reserved_count = HE_MIN(reserved_processor_count, processors.count - 1);
+        processors.count -= reserved_count;
+    }
+
+    U32 thread_count = processors.count;
     HE_ASSERT(thread_count);
 
+    U32 &background_thread_count = job_system_state.background_thread_count;
+    background_thread_count = thread_count / 4;
+    HE_DECLARE_CVAR("job_system", background_thread_count, CVarFlag_None);
+
+    // at least one thread has to be left for frame work, with no background threads the workers run background jobs last.
+    if (background_thread_count >= thread_count)
+    {
+        background_thread_count = thread_count - 1;
+    }
+
+    U32 worker_thread_count = thread_count - background_thread_count;
+
     job_system_state.running.store(true);
     job_system_state.in_progress_job_count.store(0);
+    job_system_state.waiting_thread_count.store(0);
     job_system_state.thread_count = thread_count;
-    job_system_state.thread_states = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Thread_State, thread_count);
+    job_system_state.thread_states = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Thread_State, thread_count + 1);
 
-    init(&job_system_state.job_pool, thread_count * JOB_COUNT_PER_THREAD, to_allocator(&job_system_state.job_data_allocator));
+    bool job_pool_inited = init(&job_system_state.job_pool, thread_count * JOB_COUNT_PER_THREAD);
+    HE_ASSERT(job_pool_inited);
 
-    for (U32 thread_index = 0; thread_index < thread_count; thread_index++)
+    init(&job_system_state.global_job_queue, thread_count * JOB_COUNT_PER_THREAD, memory_context.permenent_allocator);
+    init(&job_system_state.background_job_queue, thread_count * JOB_COUNT_PER_THREAD, memory_context.permenent_allocator);
+
+    init_worker_group(&job_system_state.worker_group);
+    init_worker_group(&job_system_state.background_group);
+
+    for (U32 thread_index = 0; thread_index < thread_count + 1; thread_index++)
     {
+        bool is_main_thread = thread_index == thread_count;
+        bool is_background_thread = !is_main_thread && thread_index >= worker_thread_count;
+
         Thread_State *thread_state = &job_system_state.thread_states[thread_index];
         thread_state->thread_index = thread_index;
+        thread_state->random_state = 0x9E3779B9u * (thread_index + 1);
+        thread_state->group = is_background_thread ? &job_system_state.background_group : &job_system_state.worker_group;
+        thread_state->prefers_background_jobs = is_background_thread;
+        thread_state->can_run_background_jobs = is_background_thread || (!is_main_thread && background_thread_count == 0);
 
-        init(&thread_state->job_queue, JOB_COUNT_PER_THREAD, memory_context.permenent_allocator);
+        for (U32 queue_index = 0; queue_index < JOB_STEALABLE_PRIORITY_COUNT; queue_index++)
+        {
+            init(&thread_state->job_queues[queue_index], JOB_COUNT_PER_THREAD, memory_context.permenent_allocator);
+        }
 
-        bool job_queue_semaphore_created = platform_create_semaphore(&thread_state->job_queue_semaphore);
-        HE_ASSERT(job_queue_semaphore_created);
+        thread_state->current_trace_id = 0;
+        thread_state->trace_buffer.write_index.store(0);
+        thread_state->trace_buffer.events = nullptr;
+        if (trace_jobs)
+        {
+            thread_state->trace_buffer.events = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Job_Trace_Event, JOB_TRACE_EVENT_COUNT_PER_THREAD);
+        }
+    }
 
-        bool job_queue_mutex_created = platform_create_mutex(&thread_state->job_queue_mutex);
-        HE_ASSERT(job_queue_mutex_created);
+    Thread_State *main_thread_state = &job_system_state.thread_states[thread_count];
+    main_thread_state->arena = &get_thread_context()->arena;
+    current_thread_state = main_thread_state;
 
-        bool dependency_mutex_created = platform_create_mutex(&thread_state->dependency_mutex);
-        HE_ASSERT(dependency_mutex_created);
+    for (U32 thread_index = 0; thread_index < thread_count; thread_index++)
+    {
+        Thread_State *thread_state = &job_system_state.thread_states[thread_index];
+        const char *thread_name = thread_state->prefers_background_jobs ? "HopeBackgroundThread" : "HopeWorkerThread";
 
-        bool thread_created_and_started = platform_create_and_start_thread(&thread_state->thread, execute_thread_work, thread_state, "HopeWorkerThread");
+        bool thread_created_and_started = platform_create_and_start_thread(&thread_state->thread, execute_thread_work, thread_state, thread_name);
         HE_ASSERT(thread_created_and_started);
 
-        U32 thread_id = platform_get_thread_id(&thread_state->thread);
-        Thread_Memory_State *memory_state = get_thread_memory_state(thread_id);
-        thread_state->arena = &memory_state->arena;
+        if (topology_known && pin_threads)
+        {
+            bool pinned = platform_set_thread_affinity(&thread_state->thread, 1ull << processors[thread_index]);
+            HE_ASSERT(pinned);
+        }
     }
 
     return true;
@@ -229,6 +668,17 @@ void deinit_job_system()
 {
     wait_for_all_jobs_to_finish();
     job_system_state.running.store(false);
+
+    U32 worker_thread_count = job_system_state.thread_count - job_system_state.background_thread_count;
+
+    bool signaled = platform_signal_semaphore(&job_system_state.worker_group.wake_semaphore, worker_thread_count);
+    HE_ASSERT(signaled);
+
+    if (job_system_state.background_thread_count)
+    {
+        signaled = platform_signal_semaphore(&job_system_state.background_group.wake_semaphore, job_system_state.background_thread_count);
+        HE_ASSERT(signaled);
+    }
 }
 
 static void init_job(Job *job, Job_Data job_data)
@@ -242,148 +692,712 @@ static void init_job(Job *job, Job_Data job_data)
         {
             alignment = HE_DEFAULT_ALIGNMENT;
         }
-        void *data = allocate(&job_system_state.job_data_allocator, job_data.parameters.size, alignment);
+
+        void *data = job->inline_data;
+
+        // the allocator is only used for parameters that don't fit in the job.
+        if (job_data.parameters.size > JOB_INLINE_DATA_SIZE || alignment > alignof(decltype(job->inline_data)))
+        {
+            data = allocate(&job_system_state.job_slab_allocator, job_data.parameters.size, alignment);
+        }
+
         copy_memory(data, job_data.parameters.data, job_data.parameters.size);
         job->data.parameters.data = data;
     }
 
-    std::atomic_store((std::atomic<bool>*)&job->finished, false);
-    platform_create_mutex(&job->dependent_jobs_mutex);
+    job->is_continuation = false;
+    job->dependency_failed.store(false, std::memory_order_relaxed);
+    job->overflow_wait_nodes = nullptr;
 }
 
-Job_Handle execute_job(Job_Data job_data, Array_View< Job_Handle > wait_for_jobs)
+static Job_Handle create_job(Job_Data job_data)
 {
     Job_Handle job_handle = acquire_handle(&job_system_state.job_pool);
-    Job *job = get(&job_system_state.job_pool, job_handle);
+    Job *job = get_job(job_handle);
     init_job(job, job_data);
+    job->waiting_jobs.store(make_wait_list_head(nullptr, job_handle.generation), std::memory_order_release);
+
+    if (job_system_state.tracing)
+    {
+        job->trace_id = job_system_state.next_trace_id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
 
-    std::atomic_store((std::atomic<U32>*)&job->remaining_job_count, wait_for_jobs.count);
+    return job_handle;
+}
 
-    for (Job_Handle dependent_job_handle : wait_for_jobs)
+// returns false if the job already finished, the handle can be stale by the time the list is read so a head with the tag
+// of another generation means the slot was reused and the job it referred to finished.
+static bool add_to_wait_list(Job_Handle job_handle, Job_Wait_Node *wait_node)
+{
+    // slots of the job pool are never decommited so the list can be read through a stale handle.
+    Job *job = &job_system_state.job_pool.data[job_handle.index];
+    U64 tag = make_wait_list_head(nullptr, job_handle.generation);
+    U64 head = job->waiting_jobs.load(std::memory_order_acquire);
+
+    do
     {
-        if (is_valid_handle(&job_system_state.job_pool, dependent_job_handle))
+        Job_Wait_Node *first_wait_node = get_wait_list_node(head);
+        if ((head & ~((1ull << JOB_WAIT_LIST_TAG_SHIFT) - 1)) != tag || first_wait_node == &closed_wait_list)
         {
-            Job *dependent_job = get(&job_system_state.job_pool, dependent_job_handle);
-            platform_lock_mutex(&dependent_job->dependent_jobs_mutex);
+            return false;
+        }
+        wait_node->next = first_wait_node;
+    }
+    while (!job->waiting_jobs.compare_exchange_weak(head, make_wait_list_head(wait_node, job_handle.generation), std::memory_order_release, std::memory_order_acquire));
 
-            if (std::atomic_load((std::atomic<bool>*)&dependent_job->finished) == false)
-            {
-                Job_Ref job_ref = { .index = job_handle.index, .generation = job_handle.generation };
-                append(&dependent_job->dependent_jobs, job_ref);
-            }
-            else
-            {
-                std::atomic_fetch_sub((std::atomic<U32>*)&job->remaining_job_count, 1);
-            }
+    return true;
+}
+
+static Job_Handle submit_job(Job_Data job_data, Array_View< Job_Handle > wait_for_jobs, bool is_continuation)
+{
+    // counted before the job can be scheduled so it can't finish before it is counted.
+    job_system_state.in_progress_job_count.fetch_add(1);
+
+    Job_Handle job_handle = create_job(job_data);
+    Job *job = get_job(job_handle);
+    job->is_continuation = is_continuation;
+
+    // the extra count keeps the job from being scheduled while it is still adding itself to wait lists.
+    job->remaining_job_count.store(wait_for_jobs.count + 1, std::memory_order_relaxed);
 
-            platform_unlock_mutex(&dependent_job->dependent_jobs_mutex);
+    Job_Wait_Node *wait_nodes = job->wait_nodes;
+    if (wait_for_jobs.count > JOB_INLINE_WAIT_NODE_COUNT)
+    {
+        wait_nodes = (Job_Wait_Node *)allocate(&job_system_state.job_slab_allocator, sizeof(Job_Wait_Node) * wait_for_jobs.count, alignof(Job_Wait_Node));
+        job->overflow_wait_nodes = wait_nodes;
+    }
+
+    U32 satisfied_count = 1;
+
+    for (U32 wait_index = 0; wait_index < wait_for_jobs.count; wait_index++)
+    {
+        Job_Handle wait_for_job_handle = wait_for_jobs[wait_index];
+        Job_Wait_Node *wait_node = &wait_nodes[wait_index];
+        wait_node->job_handle = job_handle;
+
+        if (!is_valid_job_handle(wait_for_job_handle) ||
+            !add_to_wait_list(wait_for_job_handle, wait_node))
+        {
+            satisfied_count++;
+        }
+    }
+
+    satisfy_job_dependencies(job_handle, satisfied_count);
+    return job_handle;
+}
+
+Job_Handle execute_job(Job_Data job_data, Array_View< Job_Handle > wait_for_jobs)
+{
+    return submit_job(job_data, wait_for_jobs, false);
+}
+
+void execute_jobs(Array_View< Job_Data > jobs, Job_Handle *out_job_handles)
+{
+    if (!jobs.count)
+    {
+        return;
+    }
+
+    job_system_state.in_progress_job_count.fetch_add(jobs.count);
+
+    U32 worker_job_count = 0;
+    U32 background_job_count = 0;
+
+    for (U32 job_index = 0; job_index < jobs.count; job_index++)
+    {
+        Job_Handle job_handle = create_job(jobs[job_index]);
+
+        if (out_job_handles)
+        {
+            out_job_handles[job_index] = job_handle;
+        }
+
+        Worker_Group *group = enqueue_job(job_handle, jobs[job_index].priority);
+        if (group == &job_system_state.background_group)
+        {
+            background_job_count++;
         }
         else
         {
-            std::atomic_fetch_sub((std::atomic<U32>*)&job->remaining_job_count, 1);
+            worker_job_count++;
         }
     }
 
-    if (!job->remaining_job_count)
+    if (worker_job_count)
+    {
+        wake_sleeping_threads(&job_system_state.worker_group, worker_job_count);
+    }
+
+    if (background_job_count)
     {
-        schedule_job_to_least_worked_thread(job_handle);
+        wake_sleeping_threads(&job_system_state.background_group, background_job_count);
     }
+}
 
+Job_Handle create_job_counter(U32 count)
+{
     job_system_state.in_progress_job_count.fetch_add(1);
 
+    // never scheduled, it finishes when the count reaches zero.
+    Job_Handle job_handle = create_job({});
+    Job *job = get_job(job_handle);
+    job->remaining_job_count.store(count, std::memory_order_relaxed);
+
+    if (!count)
+    {
+        finalize_job(job_handle, Job_Result::SUCCEEDED);
+        decrement_counter(&job_system_state.in_progress_job_count, 1);
+    }
+
     return job_handle;
 }
 
-void wait_for_job_to_finish(Job_Handle job_handle)
+void decrement_job_counter(Job_Handle counter, U32 amount, Job_Result result)
 {
-    if (!is_valid_handle(&job_system_state.job_pool, job_handle))
+    Job *job = get_job(counter);
+
+    // counters are never scheduled so dependency_failed only records failed decrements.
+    if (result != Job_Result::SUCCEEDED)
     {
-        return;
+        job->dependency_failed.store(true, std::memory_order_relaxed);
     }
 
-    Job *job = get(&job_system_state.job_pool, job_handle);
-    if (job)
+    U32 old_value = job->remaining_job_count.fetch_sub(amount, std::memory_order_acq_rel);
+    HE_ASSERT(old_value >= amount);
+
+    if (old_value == amount)
     {
-        while (!job->finished);
+        finalize_job(counter, job->dependency_failed.load(std::memory_order_relaxed) ? Job_Result::FAILED : Job_Result::SUCCEEDED);
+        decrement_counter(&job_system_state.in_progress_job_count, 1);
     }
 }
 
-void wait_for_all_jobs_to_finish()
+// runs one pending job on the calling thread, returns false if there was nothing to run.
+static bool help_with_pending_job()
 {
-    while (job_system_state.in_progress_job_count.load())
+    Thread_State *thread_state = current_thread_state;
+    if (!thread_state)
     {
+        return false;
     }
-#if 0
-    while (job_system_state.in_progress_job_count.load())
+
+    Job_Handle job_handle = Resource_Pool< Job >::invalid_handle;
+    if (!find_job(thread_state, &job_handle))
+    {
+        return false;
+    }
+
+    run_job(thread_state, job_handle);
+    return true;
+}
+
+static void wait_on_address(void *address, U32 compare_value)
+{
+    Thread_State *thread_state = current_thread_state;
+    bool trace = job_system_state.tracing && thread_state;
+    U64 wait_begin_time = trace ? platform_get_performance_counter() : 0;
+
+    job_system_state.waiting_thread_count.fetch_add(1);
+    platform_wait_on_address(address, &compare_value, sizeof(U32));
+    job_system_state.waiting_thread_count.fetch_sub(1);
+
+    if (trace)
     {
-        Thread_State *most_worked_thread_state = nullptr;
-        U32 most_work_count_so_far = 0;
+        record_trace_event(thread_state, { .name = "wait", .parent_id = thread_state->current_trace_id, .begin_time = wait_begin_time, .end_time = platform_get_performance_counter(), .type = Job_Trace_Event_Type::WAIT });
+    }
+}
 
-        for (U32 thread_index = 0; thread_index < job_system_state.thread_count; thread_index++)
+void wait_for_job_to_finish(Job_Handle job_handle)
+{
+    U32 spin_count = 0;
+
+    while (is_valid_job_handle(job_handle))
+    {
+        if (help_with_pending_job())
         {
-            Thread_State *thread_state = &job_system_state.thread_states[thread_index];
-            platform_lock_mutex(&thread_state->job_queue_mutex);
-            U32 job_count_in_queue = count(&thread_state->job_queue);
-            if (job_count_in_queue > 1 && job_count_in_queue > most_work_count_so_far)
-            {
-                most_worked_thread_state = thread_state;
-                most_work_count_so_far = job_count_in_queue;
-            }
-            platform_unlock_mutex(&thread_state->job_queue_mutex);
+            spin_count = 0;
+            continue;
         }
 
-        if (!most_worked_thread_state)
+        if (spin_count < JOB_WAIT_SPIN_COUNT)
         {
+            spin_count++;
+            _mm_pause();
             continue;
         }
 
-        platform_lock_mutex(&most_worked_thread_state->job_queue_mutex);
+        // the generation of the slot changes when the job is released.
+        wait_on_address(&job_system_state.job_pool.generations[job_handle.index], job_handle.generation);
+        spin_count = 0;
+    }
+}
+
+static void wait_for_counter_to_reach_zero(std::atomic< U32 > *counter)
+{
+    U32 spin_count = 0;
+
+    while (U32 value = counter->load())
+    {
+        if (help_with_pending_job())
+        {
+            spin_count = 0;
+            continue;
+        }
 
-        if (count(&most_worked_thread_state->job_queue) <= 1)
+        if (spin_count < JOB_WAIT_SPIN_COUNT)
         {
-            platform_unlock_mutex(&most_worked_thread_state->job_queue_mutex);
+            spin_count++;
+            _mm_pause();
             continue;
         }
 
-        // we don't actually wait here we just decrement the semaphore counter...
-        wait_for_semaphore(&most_worked_thread_state->job_queue_semaphore);
+        wait_on_address(counter, value);
+        spin_count = 0;
+    }
+}
 
-        Ring_Queue< Job_Handle > *job_queue = &most_worked_thread_state->job_queue;
+static void decrement_counter(std::atomic< U32 > *counter, U32 amount)
+{
+    U32 old_value = counter->fetch_sub(amount);
+    HE_ASSERT(old_value >= amount);
 
-        Job_Handle job_handle = Resource_Pool< Job >::invalid_handle;
-        bool peeked = peek_back(job_queue, &job_handle);
-        pop_back(job_queue);
-        Job *job = get(&job_system_state.job_pool, job_handle);
-        platform_unlock_mutex(&most_worked_thread_state->job_queue_mutex);
-        HE_ASSERT(job->data.proc);
+    if (old_value == amount && job_system_state.waiting_thread_count.load())
+    {
+        platform_wake_all_on_address(counter);
+    }
+}
+
+void wait_for_all_jobs_to_finish()
+{
+    wait_for_counter_to_reach_zero(&job_system_state.in_progress_job_count);
+}
+
+//
+// Parallel For
+//
+
+struct Parallel_For_State
+{
+    Parallel_For_Proc proc;
+    void *data;
+    U32 grain;
+    std::atomic< U32 > remaining_count;
+};
+
+struct Parallel_For_Job_Data
+{
+    Parallel_For_State *state;
+    U32 begin;
+    U32 end;
+};
+
+static Job_Result parallel_for_job(const Job_Parameters &params);
+
+static void run_parallel_for_range(Parallel_For_State *state, U32 begin, U32 end, Memory_Arena *arena)
+{
+    // keep splitting off the right half for other threads to steal and process the left half here.
+    while (end - begin > state->grain)
+    {
+        U32 middle = begin + (end - begin) / 2;
 
-        Temprary_Memory_Arena scratch_memory = begin_scratch_memory();
-        job->data.parameters.arena = scratch_memory.arena;
+        Parallel_For_Job_Data parallel_for_job_data =
+        {
+            .state = state,
+            .begin = middle,
+            .end = end
+        };
 
-        Job_Result result = job->data.proc(job->data.parameters);
-        if (job->data.completed_proc)
+        Job_Data job_data =
         {
-            job->data.completed_proc(result);
+            .parameters =
+            {
+                .data = &parallel_for_job_data,
+                .size = sizeof(Parallel_For_Job_Data),
+                .alignment = alignof(Parallel_For_Job_Data)
+            },
+            .proc = &parallel_for_job,
+            .priority = Job_Priority::HIGH,
+            .name = "parallel_for"
+        };
+
+        execute_job(job_data);
+        end = middle;
+    }
+
+    Parallel_For_Parameters params =
+    {
+        .arena = arena,
+        .begin = begin,
+        .end = end,
+        .data = state->data
+    };
+
+    state->proc(params);
+    decrement_counter(&state->remaining_count, end - begin);
+}
+
+static Job_Result parallel_for_job(const Job_Parameters &params)
+{
+    Parallel_For_Job_Data *job_data = (Parallel_For_Job_Data *)params.data;
+    run_parallel_for_range(job_data->state, job_data->begin, job_data->end, params.arena);
+    return Job_Result::SUCCEEDED;
+}
+
+void parallel_for(U32 begin, U32 end, U32 grain, Parallel_For_Proc proc, void *data)
+{
+    HE_ASSERT(begin <= end);
+    HE_ASSERT(proc);
+
+    if (begin == end)
+    {
+        return;
+    }
+
+    Parallel_For_State state;
+    state.proc = proc;
+    state.data = data;
+    state.grain = HE_MAX(grain, 1u);
+    state.remaining_count.store(end - begin);
+
+    Memory_Arena *arena = current_thread_state ? current_thread_state->arena : get_thread_arena();
+    Temprary_Memory temprary_memory = begin_temprary_memory(arena);
+    run_parallel_for_range(&state, begin, end, arena);
+    end_temprary_memory(temprary_memory);
+
+    wait_for_counter_to_reach_zero(&state.remaining_count);
+}
+
+struct Resume_Coroutine_Job_Data
+{
+    void *coroutine_address;
+};
+
+static Job_Result resume_coroutine_job(const Job_Parameters &params)
+{
+    Resume_Coroutine_Job_Data *job_data = (Resume_Coroutine_Job_Data *)params.data;
+    std::coroutine_handle<>::from_address(job_data->coroutine_address).resume();
+    return Job_Result::SUCCEEDED;
+}
+
+void resume_coroutine_after_jobs(void *coroutine_address, Array_View< Job_Handle > wait_for_jobs, Job_Priority priority, const char *name)
+{
+    Resume_Coroutine_Job_Data resume_coroutine_job_data =
+    {
+        .coroutine_address = coroutine_address
+    };
+
+    Job_Data job_data =
+    {
+        .parameters =
+        {
+            .data = &resume_coroutine_job_data,
+            .size = sizeof(Resume_Coroutine_Job_Data),
+            .alignment = alignof(Resume_Coroutine_Job_Data)
+        },
+        .proc = &resume_coroutine_job,
+        .priority = priority,
+        .name = name ? name : "resume_coroutine"
+    };
+
+    // the coroutine may be resumed on another thread before this returns.
+    submit_job(job_data, wait_for_jobs, true);
+}
+
+Job_Coroutine Job_Coroutine::promise_type::get_return_object()
+{
+    // the counter finishes when the coroutine returns.
+    job_handle = create_job_counter(1);
+    return { .job_handle = job_handle };
+}
+
+std::suspend_never Job_Coroutine::promise_type::final_suspend() noexcept
+{
+    decrement_job_counter(job_handle, 1, result);
+    return {};
+}
+
+void* Job_Coroutine::promise_type::operator new(size_t size)
+{
+    void *memory = allocate(&job_system_state.job_slab_allocator, size, HE_DEFAULT_ALIGNMENT);
+    HE_ASSERT(memory);
+    return memory;
+}
+
+void Job_Coroutine::promise_type::operator delete(void *memory)
+{
+    deallocate(&job_system_state.job_slab_allocator, memory);
+}
+
+void init(Task_Graph *task_graph, Allocator allocator)
+{
+    HE_ASSERT(task_graph);
+    task_graph->tasks = make_dynamic_array< Task >(allocator);
+    task_graph->allocator = allocator;
+    task_graph->counter = Resource_Pool< Job >::invalid_handle;
+}
+
+void deinit(Task_Graph *task_graph)
+{
+    reset(task_graph);
+    deinit(&task_graph->tasks);
+}
+
+void reset(Task_Graph *task_graph)
+{
+    HE_ASSERT(task_graph);
+    wait_for_job_to_finish(task_graph->counter);
+
+    for (Task &task : task_graph->tasks)
+    {
+        if (task.job_data.parameters.data)
+        {
+            HE_ALLOCATOR_DEALLOCATE(task_graph->allocator, task.job_data.parameters.data);
         }
+        deinit(&task.dependents);
+    }
+
+    reset(&task_graph->tasks);
+}
 
-        end_temprary_memory(&scratch_memory);
+U32 add_task(Task_Graph *task_graph, Job_Data job_data)
+{
+    HE_ASSERT(task_graph);
+    HE_ASSERT(job_data.proc);
 
-        finalize_job(job_handle, result);
+    if (job_data.parameters.data)
+    {
+        U16 alignment = job_data.parameters.alignment;
+        if (!alignment)
+        {
+            alignment = HE_DEFAULT_ALIGNMENT;
+        }
 
-        job_system_state.in_progress_job_count.fetch_sub(1);
+        void *data = HE_ALLOCATOR_ALLOCATE_SIZED(task_graph->allocator, job_data.parameters.size, alignment);
+        copy_memory(data, job_data.parameters.data, job_data.parameters.size);
+        job_data.parameters.data = data;
     }
-#endif
+
+    U32 task_index = task_graph->tasks.count;
+
+    Task &task = append(&task_graph->tasks);
+    task.job_data = job_data;
+    task.dependency_count = 0;
+    task.dependents = make_dynamic_array< U32 >(task_graph->allocator);
+    task.remaining_dependency_count.store(0, std::memory_order_relaxed);
+    task.pending.store(0, std::memory_order_relaxed);
+
+    return task_index;
 }
 
+void add_task_dependency(Task_Graph *task_graph, U32 task_index, U32 depends_on_task_index)
+{
+    HE_ASSERT(task_graph);
+    HE_ASSERT(task_index != depends_on_task_index);
 
-U32 get_job_thread_count()
+    Task &task = task_graph->tasks[task_index];
+    Task &depends_on_task = task_graph->tasks[depends_on_task_index];
+
+    append(&depends_on_task.dependents, task_index);
+    task.dependency_count++;
+}
+
+struct Task_Job_Data
+{
+    Task_Graph *task_graph;
+    U32 task_index;
+};
+
+static Job_Result run_task_job(const Job_Parameters &params);
+
+static void submit_task(Task_Graph *task_graph, U32 task_index)
+{
+    Task &task = task_graph->tasks[task_index];
+
+    Task_Job_Data task_job_data =
+    {
+        .task_graph = task_graph,
+        .task_index = task_index
+    };
+
+    Job_Data job_data =
+    {
+        .parameters =
+        {
+            .data = &task_job_data,
+            .size = sizeof(Task_Job_Data),
+            .alignment = alignof(Task_Job_Data)
+        },
+        .proc = &run_task_job,
+        .priority = task.job_data.priority,
+        .signal_counter = task_graph->counter,
+        .name = task.job_data.name
+    };
+
+    submit_job(job_data, { 0, nullptr }, false);
+}
+
+static Job_Result run_task_job(const Job_Parameters &params)
+{
+    Task_Job_Data *task_job_data = (Task_Job_Data *)params.data;
+    Task_Graph *task_graph = task_job_data->task_graph;
+    Task &task = task_graph->tasks[task_job_data->task_index];
+
+    Job_Parameters task_parameters = task.job_data.parameters;
+    task_parameters.arena = params.arena;
+
+    Job_Result result = task.job_data.proc(task_parameters);
+    if (task.job_data.completed_proc)
+    {
+        task.job_data.completed_proc(result);
+    }
+
+    for (U32 dependent_task_index : task.dependents)
+    {
+        Task &dependent_task = task_graph->tasks[dependent_task_index];
+        if (dependent_task.remaining_dependency_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            submit_task(task_graph, dependent_task_index);
+        }
+    }
+
+    decrement_counter(&task.pending, 1);
+    return result;
+}
+
+Job_Handle execute_task_graph(Task_Graph *task_graph)
+{
+    HE_ASSERT(task_graph);
+    wait_for_job_to_finish(task_graph->counter);
+
+    task_graph->counter = create_job_counter(task_graph->tasks.count);
+
+    for (Task &task : task_graph->tasks)
+    {
+        task.remaining_dependency_count.store(task.dependency_count, std::memory_order_relaxed);
+        task.pending.store(1, std::memory_order_relaxed);
+    }
+
+    for (U32 task_index = 0; task_index < task_graph->tasks.count; task_index++)
+    {
+        if (!task_graph->tasks[task_index].dependency_count)
+        {
+            submit_task(task_graph, task_index);
+        }
+    }
+
+    return task_graph->counter;
+}
+
+void wait_for_task(Task_Graph *task_graph, U32 task_index)
 {
-    U32 thread_count = platform_get_thread_count();
-    if (thread_count > 2)
+    HE_ASSERT(task_graph);
+    wait_for_counter_to_reach_zero(&task_graph->tasks[task_index].pending);
+}
+
+bool dump_job_trace(String path, F64 duration_in_seconds)
+{
+    if (!job_system_state.tracing)
     {
-        thread_count -= 2;
+        HE_LOG(Core, Error, "dump_job_trace -- job_system.trace_jobs was disabled at init\n");
+        return false;
     }
-    return thread_count;
+
+    Memory_Context memory_context = grab_memory_context();
+
+    U64 frequency = platform_get_performance_frequency();
+    U64 now = platform_get_performance_counter();
+    U64 duration = (U64)(duration_in_seconds * (F64)frequency);
+    U64 window_begin_time = now > duration ? now - duration : 0;
+
+    // allocated before the builder since the builder grows in place at the end of the same arena.
+    Job_Trace_Event *events = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, Job_Trace_Event, JOB_TRACE_EVENT_COUNT_PER_THREAD);
+
+    String_Builder builder = {};
+    begin_string_builder(&builder, memory_context.temprary_memory.arena);
+    append(&builder, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    F64 microseconds_per_count = 1000000.0 / (F64)frequency;
+
+    U32 thread_state_count = job_system_state.thread_count + 1;
+
+    for (U32 thread_index = 0; thread_index < thread_state_count; thread_index++)
+    {
+        Thread_State *thread_state = &job_system_state.thread_states[thread_index];
+        Job_Trace_Buffer *trace_buffer = &thread_state->trace_buffer;
+
+        const char *thread_name = "HopeMainThread";
+        if (thread_index != job_system_state.thread_count)
+        {
+            thread_name = thread_state->prefers_background_jobs ? "HopeBackgroundThread" : "HopeWorkerThread";
+        }
+
+        append(&builder, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}},\n", thread_index, thread_name, thread_index);
+
+        // the owner keeps writing while we copy, events it overwrote in the meantime are dropped.
+        U64 end_index = trace_buffer->write_index.load(std::memory_order_acquire);
+        U64 begin_index = end_index > JOB_TRACE_EVENT_COUNT_PER_THREAD ? end_index - JOB_TRACE_EVENT_COUNT_PER_THREAD : 0;
+
+        for (U64 event_index = begin_index; event_index < end_index; event_index++)
+        {
+            events[event_index - begin_index] = trace_buffer->events[event_index & (JOB_TRACE_EVENT_COUNT_PER_THREAD - 1)];
+        }
+
+        U64 new_write_index = trace_buffer->write_index.load(std::memory_order_acquire);
+        // the event at new_write_index may be half written over the slot of new_write_index - JOB_TRACE_EVENT_COUNT_PER_THREAD.
+        U64 first_valid_index = new_write_index >= JOB_TRACE_EVENT_COUNT_PER_THREAD ? new_write_index - JOB_TRACE_EVENT_COUNT_PER_THREAD + 1 : 0;
+
+        for (U64 event_index = HE_MAX(begin_index, first_valid_index); event_index < end_index; event_index++)
+        {
+            const Job_Trace_Event &event = events[event_index - begin_index];
+            if (event.end_time < window_begin_time)
+            {
+                continue;
+            }
+
+            F64 begin = (F64)(event.begin_time - window_begin_time) * microseconds_per_count;
+            F64 duration = (F64)(event.end_time - event.begin_time) * microseconds_per_count;
+
+            if (event.begin_time < window_begin_time)
+            {
+                begin = 0.0;
+                duration = (F64)(event.end_time - window_begin_time) * microseconds_per_count;
+            }
+
+            if (event.type != Job_Trace_Event_Type::JOB)
+            {
+                append(&builder, "{\"name\":\"%s\",\"cat\":\"idle\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+                       event.name, thread_index, begin, duration);
+                continue;
+            }
+
+            F64 queue_time = event.ready_time && event.ready_time < event.begin_time ? (F64)(event.begin_time - event.ready_time) * microseconds_per_count : 0.0;
+
+            append(&builder, "{\"name\":\"%s\",\"cat\":\"job\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"id\":%llu,\"parent_id\":%llu,\"queue_time_us\":%.3f}},\n",
+                   event.name, thread_index, begin, duration, event.id, event.parent_id, queue_time);
+
+            // dependency edges as flow events, every job starts a flow that the jobs it scheduled finish.
+            append(&builder, "{\"name\":\"schedule\",\"cat\":\"dependency\",\"ph\":\"s\",\"id\":%llu,\"pid\":0,\"tid\":%u,\"ts\":%.3f},\n",
+                   event.id, thread_index, begin + duration);
+
+            if (event.parent_id)
+            {
+                append(&builder, "{\"name\":\"schedule\",\"cat\":\"dependency\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%llu,\"pid\":0,\"tid\":%u,\"ts\":%.3f},\n",
+                       event.parent_id, thread_index, begin);
+            }
+        }
+    }
+
+    // the metadata event keeps the array well formed after the trailing comma.
+    append(&builder, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"Hope\"}}\n]}\n");
+
+    String json = end_string_builder(&builder);
+    return write_entire_file(path, (void *)json.data, json.count);
+}
+
+U32 get_job_thread_count()
+{
+    HE_ASSERT(job_system_state.thread_count);
+    return job_system_state.thread_count;
 }
 
 U32 get_effective_thread_count()
@@ -4,6 +4,10 @@
 #include "containers/array_view.h"
 #include "containers/dynamic_array.h"
 #include "containers/resource_pool.h"
+#include "containers/string.h"
+
+#include <atomic>
+#include <coroutine>
 
 enum class Job_Result : U8
 {
@@ -24,27 +28,53 @@ struct Job_Parameters
 
 typedef Job_Result (*Job_Proc)(const Job_Parameters &params);
 
+enum class Job_Priority : U8
+{
+    NORMAL,
+    HIGH,       // frame critical work, runs before normal jobs.
+    BACKGROUND, // long running or blocking work (file io, asset loading), runs on the background threads.
+};
+
 struct Job_Data
 {
     Job_Parameters     parameters;
     Job_Proc           proc;
     Job_Completed_Proc completed_proc;
+    Job_Priority       priority = Job_Priority::NORMAL;
+    Resource_Handle< struct Job > signal_counter = { -1, 0 }; // job counter decremented once the job finished.
+    const char         *name = nullptr; // shows up in job traces.
 };
 
-struct Job_Ref
+#define JOB_INLINE_WAIT_NODE_COUNT 4
+#define JOB_INLINE_DATA_SIZE 64
+
+struct Job_Wait_Node
 {
-    S32 index;
-    U32 generation;
+    Resource_Handle< struct Job > job_handle; // the job that is waiting.
+    Job_Wait_Node *next;
 };
 
 struct Job
 {
-    Job_Data            data;
-    volatile bool       finished;
+    Job_Data                      data;
+    bool                          is_continuation; // runs even if one of the jobs it waits for failed.
+    std::atomic< bool >           dependency_failed;
+    std::atomic< U32 >            remaining_job_count;
+
+    // jobs waiting on this job, closed when the job finishes. the first node pointer is packed with the low bits
+    // of the job generation so a waiter holding a stale handle can't link itself to a job that reused the slot.
+    std::atomic< U64 > waiting_jobs;
+
+    // one node per job this job waits on, overflow_wait_nodes is allocated when it waits on more than JOB_INLINE_WAIT_NODE_COUNT jobs.
+    Job_Wait_Node                 wait_nodes[JOB_INLINE_WAIT_NODE_COUNT];
+    Job_Wait_Node                 *overflow_wait_nodes;
+    // filled only when job_system.trace_jobs is enabled.
+    U64                           trace_id;
+    U64                           trace_parent_id;
+    U64                           trace_ready_time;
 
-    volatile U32             remaining_job_count;
-    Mutex                    dependent_jobs_mutex;
-    Dynamic_Array< Job_Ref > dependent_jobs;
+    // parameters up to JOB_INLINE_DATA_SIZE bytes are copied here instead of the job data allocator.
+    alignas(HE_DEFAULT_ALIGNMENT) U8 inline_data[JOB_INLINE_DATA_SIZE];
 };
 
 using Job_Handle = Resource_Handle< Job >;
@@ -54,8 +84,140 @@ void deinit_job_system();
 
 Job_Handle execute_job(Job_Data job_data, Array_View< Job_Handle > wait_for_jobs = { 0, nullptr });
 
+// submits independent jobs with a single wake up, out_job_handles has to hold jobs.count handles if provided.
+void execute_jobs(Array_View< Job_Data > jobs, Job_Handle *out_job_handles = nullptr);
+
+// a job counter is a job without a proc that finishes once it was decremented count times, it can be waited on,
+// co_awaited or passed as a dependency like any other job. jobs decrement it through Job_Data::signal_counter.
+// the counter finishes as failed if any decrement passed a result other than SUCCEEDED.
+Job_Handle create_job_counter(U32 count);
+void decrement_job_counter(Job_Handle counter, U32 amount = 1, Job_Result result = Job_Result::SUCCEEDED);
+
 void wait_for_job_to_finish(Job_Handle job_handle);
 void wait_for_all_jobs_to_finish();
 
+struct Parallel_For_Parameters
+{
+    struct Memory_Arena *arena;
+    U32 begin;
+    U32 end;
+    void *data;
+};
+
+typedef void (*Parallel_For_Proc)(const Parallel_For_Parameters &params);
+
+// splits [begin, end) recursively into ranges of at most grain elements and blocks until all of them are processed,
+// the calling thread processes ranges too.
+void parallel_for(U32 begin, U32 end, U32 grain, Parallel_For_Proc proc, void *data = nullptr);
+
+// resumes the coroutine on a job thread with the given priority after all the jobs finished whether they succeeded or not.
+void resume_coroutine_after_jobs(void *coroutine_address, Array_View< Job_Handle > wait_for_jobs, Job_Priority priority, const char *name = nullptr);
+
+// coroutine that runs on the calling thread until its first co_await and continues on the job threads after that.
+// job_handle stays valid until the coroutine returns so it can be waited on or passed as a dependency like any other job,
+// the job finishes with the result the coroutine co_returns.
+struct Job_Coroutine
+{
+    struct promise_type
+    {
+        Job_Handle job_handle;
+        Job_Result result = Job_Result::FAILED;
+
+        Job_Coroutine get_return_object();
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept;
+        void return_value(Job_Result value) { result = value; }
+        void unhandled_exception() {}
+
+        static void* operator new(size_t size);
+        static void operator delete(void *memory);
+    };
+
+    Job_Handle job_handle;
+};
+
+// always suspends, a co_await never continues on the thread that reached it.
+struct Job_Awaiter
+{
+    Array_View< Job_Handle > wait_for_jobs;
+    Job_Handle job_handle; // used when wait_for_jobs is empty.
+    Job_Priority priority;
+    const char *name; // name of the job that resumes the coroutine in job traces.
+
+    bool await_ready() const noexcept { return false; }
+    void await_resume() const noexcept {}
+
+    void await_suspend(std::coroutine_handle<> coroutine) const
+    {
+        if (wait_for_jobs.count)
+        {
+            resume_coroutine_after_jobs(coroutine.address(), wait_for_jobs, priority, name);
+        }
+        else
+        {
+            resume_coroutine_after_jobs(coroutine.address(), { .count = 1, .data = &job_handle }, priority, name);
+        }
+    }
+};
+
+HE_FORCE_INLINE Job_Awaiter resume_after_jobs(Array_View< Job_Handle > wait_for_jobs, Job_Priority priority = Job_Priority::NORMAL, const char *name = nullptr)
+{
+    return { .wait_for_jobs = wait_for_jobs, .job_handle = Resource_Pool< Job >::invalid_handle, .priority = priority, .name = name };
+}
+
+HE_FORCE_INLINE Job_Awaiter resume_after_job(Job_Handle job_handle, Job_Priority priority = Job_Priority::NORMAL, const char *name = nullptr)
+{
+    return { .wait_for_jobs = { 0, nullptr }, .job_handle = job_handle, .priority = priority, .name = name };
+}
+
+// moves the coroutine to a job thread with the given priority.
+HE_FORCE_INLINE Job_Awaiter switch_to_job_thread(Job_Priority priority)
+{
+    return resume_after_job(Resource_Pool< Job >::invalid_handle, priority);
+}
+
+HE_FORCE_INLINE Job_Awaiter operator co_await(Job_Handle job_handle)
+{
+    return resume_after_job(job_handle);
+}
+
+struct Task
+{
+    Job_Data job_data; // parameters are owned by the task graph.
+
+    U32 dependency_count;
+    Dynamic_Array< U32 > dependents;
+
+    std::atomic< U32 > remaining_dependency_count;
+    std::atomic< U32 > pending; // one from execute_task_graph until the task finished.
+};
+
+// a fixed set of tasks and dependencies that is built once and executed many times without allocating.
+// a task runs after the tasks it depends on finished whether they succeeded or not.
+struct Task_Graph
+{
+    Dynamic_Array< Task > tasks;
+    Allocator allocator;
+    Job_Handle counter; // finishes when every task of the last execution finished.
+};
+
+void init(Task_Graph *task_graph, Allocator allocator);
+void deinit(Task_Graph *task_graph);
+
+// removes every task, waits for the last execution to finish first.
+void reset(Task_Graph *task_graph);
+
+U32 add_task(Task_Graph *task_graph, Job_Data job_data);
+void add_task_dependency(Task_Graph *task_graph, U32 task_index, U32 depends_on_task_index);
+
+// waits for the previous execution to finish, the returned counter finishes when every task finished.
+Job_Handle execute_task_graph(Task_Graph *task_graph);
+void wait_for_task(Task_Graph *task_graph, U32 task_index);
+
+// writes the job events of the last duration_in_seconds as chrome trace event json (chrome://tracing or ui.perfetto.dev),
+// requires the job_system.trace_jobs cvar to be set at startup.
+bool dump_job_trace(String path, F64 duration_in_seconds);
+
+// valid after init_job_system, depends on the job_system thread policy cvars.
 U32 get_job_thread_count();
 U32 get_effective_thread_count();
\ No newline at end of file
@@ -1,10 +1,14 @@
 #include "memory.h"
 #include "platform.h"
 #include "rendering/renderer.h"
-#include "containers/hash_map.h"
 #include "core/logging.h"
+#include "core/cvars.h"
 
 #include <string.h>
+#include <atomic>
+#include <bit>
+#include <stddef.h>
+#include <immintrin.h>
 
 #include <imgui.h>
 
@@ -22,9 +26,24 @@ void copy_memory(void *dst, const void *src, U64 size)
     memcpy(dst, src, size);
 }
 
+// an arena is reset right after its frame is retired and only receives memory for frames that start later,
+// so the ring needs a slot for every frame in flight plus the frames ahead.
+#define HE_FRAME_MEMORY_COUNT (HE_MAX_FRAMES_IN_FLIGHT + HE_MAX_FRAME_MEMORY_FRAMES_AHEAD)
+
+struct Frame_Memory
+{
+    Memory_Arena arena;
+    std::atomic< U64 > frame; // the frame that reads memory from this arena.
+    Mutex mutex;
+};
+
 struct Memory_System
 {
+    U64 main_thread_arena_capacity;
     U64 thread_arena_capacity;
+    U64 thread_arena_min_allocation_size; // below the capacity so trimming can give memory back.
+    U64 arena_decommit_threshold; // for the frame and thread arenas.
+    U32 arena_decommit_threshold_mb;
 
     Memory_Arena permenent_arena;
     Allocator permenent_allocator;
@@ -38,17 +57,316 @@ struct Memory_System
     Free_List_Allocator general_free_list_allocator;
     Allocator general_allocator;
 
-    Hash_Map< U32, Thread_Memory_State > thread_id_to_memory_state;
+    Slab_Allocator small_object_allocator;
+    Allocator slab_allocator;
+
+    Frame_Memory frame_memories[HE_FRAME_MEMORY_COUNT];
+
+    Mutex budget_mutex;
+    std::atomic< U64 > frame; // frames started with begin_frame_memory, published after the retired arenas moved on.
+
+    Thread_Context thread_contexts[HE_MAX_THREAD_CONTEXT_COUNT];
+    std::atomic< U32 > thread_context_count;
 };
 
 static Memory_System memory_system_state;
+static thread_local Thread_Context *current_thread_context = nullptr;
+
+//
+// Memory Tracking
+//
+
+struct Memory_Tag_Counters
+{
+    std::atomic< U64 > live_bytes; // always counted, budgets depend on it.
+
+#if HE_MEMORY_TRACKING
+    std::atomic< U64 > allocation_count;
+    std::atomic< U64 > peak_bytes;
+    std::atomic< U64 > allocated_bytes;
+    U64 frame_allocated_bytes;
+    U64 frame_start_allocated_bytes;
+#endif
+};
+
+static Memory_Tag_Counters memory_tag_counters[(U32)Memory_Tag::COUNT];
+
+struct Memory_Pressure_Callback
+{
+    memory_pressure_proc proc;
+    void *user_data;
+};
+
+struct Memory_Tag_Budget
+{
+    std::atomic< U64 > soft_budget;
+    std::atomic< U64 > hard_budget;
+
+    // guarded by the budget mutex.
+    U32 callback_count;
+    Memory_Pressure_Callback callbacks[HE_MAX_MEMORY_PRESSURE_CALLBACK_COUNT];
+};
+
+static Memory_Tag_Budget memory_tag_budgets[(U32)Memory_Tag::COUNT];
+
+static thread_local Memory_Tag thread_memory_tag = Memory_Tag::UNTAGGED;
+
+static const char *memory_tag_names[] =
+{
+    "untagged",
+    "assets",
+    "textures",
+    "shaders",
+    "materials",
+    "meshes",
+    "scenes",
+    "renderer",
+    "jobs",
+    "editor",
+    "logging"
+};
+
+static_assert(HE_ARRAYCOUNT(memory_tag_names) == (U32)Memory_Tag::COUNT);
+
+const char* memory_tag_to_string(Memory_Tag tag)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+    return memory_tag_names[(U32)tag];
+}
+
+Memory_Tag set_thread_memory_tag(Memory_Tag tag)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+    Memory_Tag previous_tag = thread_memory_tag;
+    thread_memory_tag = tag;
+    return previous_tag;
+}
+
+Memory_Tag get_thread_memory_tag()
+{
+    return thread_memory_tag;
+}
+
+static void record_tag_allocation(Memory_Tag tag, U64 size)
+{
+    Memory_Tag_Counters *counters = &memory_tag_counters[(U32)tag];
+    U64 live_bytes = counters->live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+
+#if HE_MEMORY_TRACKING
+    counters->allocation_count.fetch_add(1, std::memory_order_relaxed);
+    counters->allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    U64 peak_bytes = counters->peak_bytes.load(std::memory_order_relaxed);
+    while (live_bytes > peak_bytes && !counters->peak_bytes.compare_exchange_weak(peak_bytes, live_bytes, std::memory_order_relaxed))
+    {
+    }
+#endif
+}
+
+static void record_tag_deallocation(Memory_Tag tag, U64 size)
+{
+    Memory_Tag_Counters *counters = &memory_tag_counters[(U32)tag];
+    counters->live_bytes.fetch_sub(size, std::memory_order_relaxed);
+
+#if HE_MEMORY_TRACKING
+    counters->allocation_count.fetch_sub(1, std::memory_order_relaxed);
+#endif
+}
+
+void record_external_allocation(Memory_Tag tag, U64 size)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+    record_tag_allocation(tag, size);
+}
+
+void record_external_deallocation(Memory_Tag tag, U64 size)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+    record_tag_deallocation(tag, size);
+}
+
+U64 get_memory_tag_live_bytes(Memory_Tag tag)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+    return memory_tag_counters[(U32)tag].live_bytes.load(std::memory_order_relaxed);
+}
+
+//
+// Memory Budgets
+//
+
+void set_memory_budget(Memory_Tag tag, U64 soft_budget, U64 hard_budget)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+    HE_ASSERT(!hard_budget || hard_budget >= soft_budget);
+
+    Memory_Tag_Budget *budget = &memory_tag_budgets[(U32)tag];
+    budget->soft_budget.store(soft_budget, std::memory_order_relaxed);
+    budget->hard_budget.store(hard_budget, std::memory_order_relaxed);
+}
+
+Memory_Budget get_memory_budget(Memory_Tag tag)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+
+    Memory_Tag_Budget *budget = &memory_tag_budgets[(U32)tag];
+    return
+    {
+        .soft_budget = budget->soft_budget.load(std::memory_order_relaxed),
+        .hard_budget = budget->hard_budget.load(std::memory_order_relaxed)
+    };
+}
+
+Memory_Pressure get_memory_pressure(Memory_Tag tag)
+{
+    Memory_Budget budget = get_memory_budget(tag);
+    U64 live_bytes = get_memory_tag_live_bytes(tag);
+
+    if (budget.hard_budget && live_bytes > budget.hard_budget)
+    {
+        return Memory_Pressure::HARD;
+    }
+
+    if (budget.soft_budget && live_bytes > budget.soft_budget)
+    {
+        return Memory_Pressure::SOFT;
+    }
+
+    return Memory_Pressure::NONE;
+}
+
+bool register_memory_pressure_callback(Memory_Tag tag, memory_pressure_proc proc, void *user_data)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+    HE_ASSERT(proc);
+
+    platform_lock_mutex(&memory_system_state.budget_mutex);
+    HE_DEFER { platform_unlock_mutex(&memory_system_state.budget_mutex); };
+
+    Memory_Tag_Budget *budget = &memory_tag_budgets[(U32)tag];
+
+    for (U32 callback_index = 0; callback_index < budget->callback_count; callback_index++)
+    {
+        Memory_Pressure_Callback *callback = &budget->callbacks[callback_index];
+        if (callback->proc == proc && callback->user_data == user_data)
+        {
+            return true;
+        }
+    }
+
+    if (budget->callback_count == HE_MAX_MEMORY_PRESSURE_CALLBACK_COUNT)
+    {
+        return false;
+    }
+
+    budget->callbacks[budget->callback_count++] = { .proc = proc, .user_data = user_data };
+    return true;
+}
+
+void unregister_memory_pressure_callback(Memory_Tag tag, memory_pressure_proc proc, void *user_data)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+
+    platform_lock_mutex(&memory_system_state.budget_mutex);
+    HE_DEFER { platform_unlock_mutex(&memory_system_state.budget_mutex); };
+
+    Memory_Tag_Budget *budget = &memory_tag_budgets[(U32)tag];
+
+    for (U32 callback_index = 0; callback_index < budget->callback_count; callback_index++)
+    {
+        Memory_Pressure_Callback *callback = &budget->callbacks[callback_index];
+        if (callback->proc == proc && callback->user_data == user_data)
+        {
+            // keeps the registration order, callbacks registered first run first.
+            for (U32 index = callback_index + 1; index < budget->callback_count; index++)
+            {
+                budget->callbacks[index - 1] = budget->callbacks[index];
+            }
+            budget->callback_count--;
+            return;
+        }
+    }
+}
+
+// the callbacks are copied out so they can register, allocate and take their own locks.
+static void run_memory_pressure_callbacks(Memory_Tag tag, U64 target_bytes)
+{
+    Memory_Tag_Budget *budget = &memory_tag_budgets[(U32)tag];
+    Memory_Pressure_Callback callbacks[HE_MAX_MEMORY_PRESSURE_CALLBACK_COUNT];
+
+    platform_lock_mutex(&memory_system_state.budget_mutex);
+    U32 callback_count = budget->callback_count;
+    copy_memory(callbacks, budget->callbacks, sizeof(Memory_Pressure_Callback) * callback_count);
+    platform_unlock_mutex(&memory_system_state.budget_mutex);
+
+    for (U32 callback_index = 0; callback_index < callback_count; callback_index++)
+    {
+        U64 live_bytes = get_memory_tag_live_bytes(tag);
+        if (live_bytes <= target_bytes)
+        {
+            break;
+        }
+
+        Memory_Pressure_Callback *callback = &callbacks[callback_index];
+        callback->proc(tag, live_bytes, target_bytes, callback->user_data);
+    }
+}
+
+bool reclaim_memory(Memory_Tag tag, U64 size)
+{
+    HE_ASSERT(tag < Memory_Tag::COUNT);
+
+    U64 hard_budget = memory_tag_budgets[(U32)tag].hard_budget.load(std::memory_order_relaxed);
+    if (!hard_budget)
+    {
+        return true;
+    }
+
+    if (get_memory_tag_live_bytes(tag) + size <= hard_budget)
+    {
+        return true;
+    }
+
+    U64 target_bytes = size < hard_budget ? hard_budget - size : 0;
+    run_memory_pressure_callbacks(tag, target_bytes);
+    return get_memory_tag_live_bytes(tag) + size <= hard_budget;
+}
+
+// allocator stats are updated by the owning thread or under the allocator mutex.
+static void record_allocation(Memory_Stats *stats, U64 size)
+{
+    stats->live_bytes += size;
+    stats->allocation_count++;
+    stats->allocated_bytes += size;
+    stats->peak_bytes = HE_MAX(stats->peak_bytes, stats->live_bytes);
+}
+
+static void record_deallocation(Memory_Stats *stats, U64 size)
+{
+    HE_ASSERT(stats->live_bytes >= size);
+    HE_ASSERT(stats->allocation_count);
+    stats->live_bytes -= size;
+    stats->allocation_count--;
+}
+
+static void update_frame_stats(Memory_Stats *stats)
+{
+    stats->frame_allocated_bytes = stats->allocated_bytes - stats->frame_start_allocated_bytes;
+    stats->frame_start_allocated_bytes = stats->allocated_bytes;
+}
 
 bool init_memory_system()
 {
     memory_system_state.thread_arena_capacity = HE_MEGA_BYTES(128);
+    memory_system_state.thread_arena_min_allocation_size = HE_MEGA_BYTES(32);
+    memory_system_state.arena_decommit_threshold_mb = 64;
+    memory_system_state.arena_decommit_threshold = HE_MEGA_BYTES(memory_system_state.arena_decommit_threshold_mb);
     U64 capacity = platform_get_total_memory_size();
 
-    if (!init_memory_arena(&memory_system_state.permenent_arena, capacity, HE_MEGA_BYTES(64)))
+    // big temprary loads like reading whole files happen on the main thread.
+    memory_system_state.main_thread_arena_capacity = capacity;
+
+    if (!init_memory_arena(&memory_system_state.permenent_arena, capacity, HE_MEGA_BYTES(64), MemoryArenaFlag_LargePages))
     {
         return false;
     }
@@ -60,6 +378,7 @@ bool init_memory_system()
         return false;
     }
 
+    memory_system_state.frame_arena.decommit_threshold = memory_system_state.arena_decommit_threshold;
     memory_system_state.frame_allocator = to_allocator(&memory_system_state.frame_arena);
 
     if (!init_memory_arena(&memory_system_state.debug_arena, capacity, HE_MEGA_BYTES(64)))
@@ -69,27 +388,75 @@ bool init_memory_system()
 
     memory_system_state.debug_allocator = to_allocator(&memory_system_state.debug_arena);
 
-    if (!init_free_list_allocator(&memory_system_state.general_free_list_allocator, nullptr, capacity, HE_MEGA_BYTES(512), "general_free_list_allocator"))
+    if (!init_free_list_allocator(&memory_system_state.general_free_list_allocator, nullptr, capacity, HE_MEGA_BYTES(512), "general_free_list_allocator", true))
     {
         return false;
     }
 
     memory_system_state.general_allocator = to_allocator(&memory_system_state.general_free_list_allocator);
 
-    init(&memory_system_state.thread_id_to_memory_state, get_effective_thread_count(), to_allocator(&memory_system_state.permenent_arena));
+    if (!init_slab_allocator(&memory_system_state.small_object_allocator, HE_GIGA_BYTES(4), memory_system_state.general_allocator, SlabAllocatorFlag_ThreadCaches, "slab_allocator"))
+    {
+        return false;
+    }
+
+    memory_system_state.slab_allocator = to_allocator(&memory_system_state.small_object_allocator);
+
+    bool budget_mutex_created = platform_create_mutex(&memory_system_state.budget_mutex);
+    HE_ASSERT(budget_mutex_created);
 
-    S32 slot_index = insert(&memory_system_state.thread_id_to_memory_state, platform_get_current_thread_id());
-    HE_ASSERT(slot_index != -1);
+    memory_system_state.frame.store(0, std::memory_order_relaxed);
 
-    Thread_Memory_State *main_thread_memory_state = &memory_system_state.thread_id_to_memory_state.values[slot_index];
-    if (!init_memory_arena(&main_thread_memory_state->arena, capacity, memory_system_state.thread_arena_capacity))
+    for (U32 frame_index = 0; frame_index < HE_FRAME_MEMORY_COUNT; frame_index++)
+    {
+        Frame_Memory *frame_memory = &memory_system_state.frame_memories[frame_index];
+        if (!init_memory_arena(&frame_memory->arena, capacity, HE_MEGA_BYTES(8)))
+        {
+            return false;
+        }
+
+        frame_memory->arena.decommit_threshold = memory_system_state.arena_decommit_threshold;
+        frame_memory->frame.store(frame_index, std::memory_order_relaxed);
+
+        bool mutex_created = platform_create_mutex(&frame_memory->mutex);
+        HE_ASSERT(mutex_created);
+    }
+
+    memory_system_state.thread_context_count.store(0);
+
+    Thread_Context *main_thread_context = register_thread_context();
+    if (!main_thread_context)
     {
         return false;
     }
 
+    HE_ASSERT(main_thread_context->thread_index == 0);
     return true;
 }
 
+void declare_memory_cvars()
+{
+    U32 &arena_decommit_threshold_mb = memory_system_state.arena_decommit_threshold_mb;
+    HE_DECLARE_CVAR("memory", arena_decommit_threshold_mb, CVarFlag_None);
+
+    // zero would turn trimming off, the threshold is only read when arenas are created and here.
+    U64 arena_decommit_threshold = HE_MEGA_BYTES((U64)HE_MAX(arena_decommit_threshold_mb, 1u));
+    memory_system_state.arena_decommit_threshold = arena_decommit_threshold;
+    memory_system_state.frame_arena.decommit_threshold = arena_decommit_threshold;
+
+    for (U32 frame_index = 0; frame_index < HE_FRAME_MEMORY_COUNT; frame_index++)
+    {
+        memory_system_state.frame_memories[frame_index].arena.decommit_threshold = arena_decommit_threshold;
+    }
+
+    // runs before the job threads start so only the main thread has registered its context.
+    U32 thread_context_count = memory_system_state.thread_context_count.load();
+    for (U32 thread_index = 0; thread_index < thread_context_count; thread_index++)
+    {
+        memory_system_state.thread_contexts[thread_index].arena.decommit_threshold = arena_decommit_threshold;
+    }
+}
+
 void deinit_memory_system()
 {
     HE_ASSERT(memory_system_state.permenent_arena.temp_count == 0);
@@ -99,23 +466,52 @@ void deinit_memory_system()
     HE_ASSERT(arena->temp_count == 0);
 }
 
-Thread_Memory_State *get_thread_memory_state(U32 thread_id)
+Thread_Context *register_thread_context()
 {
-    auto it = find(&memory_system_state.thread_id_to_memory_state, thread_id);
+    HE_ASSERT(!current_thread_context);
+
+    U32 thread_index = memory_system_state.thread_context_count.fetch_add(1);
+    HE_ASSERT(thread_index < HE_MAX_THREAD_CONTEXT_COUNT);
 
-    if (is_valid(it))
+    Thread_Context *thread_context = &memory_system_state.thread_contexts[thread_index];
+    thread_context->thread_index = thread_index;
+
+    // init_memory_system registers the main thread first, string builders and file paths write into the commited
+    // space of the arena so the main thread keeps the thread arena capacity commited.
+    U64 thread_arena_capacity = memory_system_state.thread_arena_capacity;
+    U64 thread_arena_min_allocation_size = memory_system_state.thread_arena_min_allocation_size;
+    if (!thread_index)
     {
-        return it.value;
+        thread_arena_capacity = memory_system_state.main_thread_arena_capacity;
+        thread_arena_min_allocation_size = memory_system_state.thread_arena_capacity;
     }
 
-    S32 slot_index = insert(&memory_system_state.thread_id_to_memory_state, thread_id);
-    Thread_Memory_State *thread_memory_state = &memory_system_state.thread_id_to_memory_state.values[slot_index];
-    if (!init_memory_arena(&thread_memory_state->arena, memory_system_state.thread_arena_capacity, memory_system_state.thread_arena_capacity))
+    if (!init_memory_arena(&thread_context->arena, thread_arena_capacity, thread_arena_min_allocation_size))
     {
         return nullptr;
     }
-    
-    return thread_memory_state;
+
+    thread_context->arena.decommit_threshold = memory_system_state.arena_decommit_threshold;
+
+    current_thread_context = thread_context;
+    return thread_context;
+}
+
+Thread_Context *get_thread_context()
+{
+    HE_ASSERT(current_thread_context);
+    return current_thread_context;
+}
+
+Thread_Context *get_thread_context(U32 thread_index)
+{
+    HE_ASSERT(thread_index < get_thread_context_count());
+    return &memory_system_state.thread_contexts[thread_index];
+}
+
+U32 get_thread_context_count()
+{
+    return HE_MIN(memory_system_state.thread_context_count.load(std::memory_order_acquire), (U32)HE_MAX_THREAD_CONTEXT_COUNT);
 }
 
 Memory_Arena* get_permenent_arena()
@@ -125,11 +521,8 @@ Memory_Arena* get_permenent_arena()
 
 Memory_Arena* get_thread_arena()
 {
-    U32 thread_id = platform_get_current_thread_id();
-    auto it = find(&memory_system_state.thread_id_to_memory_state, thread_id);
-    HE_ASSERT(is_valid(it));
-    Thread_Memory_State *memory_state = it.value;
-    return &memory_state->arena;
+    HE_ASSERT(current_thread_context);
+    return &current_thread_context->arena;
 }
 
 Memory_Arena* get_frame_arena()
@@ -154,6 +547,7 @@ Memory_Context grab_memory_context()
         .permenent_allocator = memory_system_state.permenent_allocator,
         .general_allocator   = memory_system_state.general_allocator,
         .frame_allocator     = memory_system_state.frame_allocator,
+        .slab_allocator      = memory_system_state.slab_allocator,
         .temprary_memory     = begin_temprary_memory(arena),
         .temp_allocator      = to_allocator(arena),
         .dropped             = false
@@ -178,23 +572,135 @@ bool drop_memory_context(Memory_Context *memory_context, Allocator allocator)
     return false;
 }
 
+//
+// Frame Memory
+//
+
+static void* frame_memory_allocate(void *frame_memory_data, U64 size, U16 alignment)
+{
+    Frame_Memory *frame_memory = (Frame_Memory *)frame_memory_data;
+    platform_lock_mutex(&frame_memory->mutex);
+    void *result = allocate(&frame_memory->arena, size, alignment);
+    platform_unlock_mutex(&frame_memory->mutex);
+    return result;
+}
+
+static void* frame_memory_reallocate(void *frame_memory_data, void *memory, U64 old_size, U64 new_size, U16 alignment)
+{
+    Frame_Memory *frame_memory = (Frame_Memory *)frame_memory_data;
+    platform_lock_mutex(&frame_memory->mutex);
+    void *result = reallocate(&frame_memory->arena, memory, old_size, new_size, alignment);
+    platform_unlock_mutex(&frame_memory->mutex);
+    return result;
+}
+
+static void frame_memory_deallocate(void *frame_memory_data, void *memory)
+{
+}
+
+static void* frame_memory_allocate_uninitialized(void *frame_memory_data, U64 size, U16 alignment)
+{
+    Frame_Memory *frame_memory = (Frame_Memory *)frame_memory_data;
+    platform_lock_mutex(&frame_memory->mutex);
+    void *result = allocate_uninitialized(&frame_memory->arena, size, alignment);
+    platform_unlock_mutex(&frame_memory->mutex);
+    return result;
+}
+
+Allocator grab_frame_memory(U32 frames_ahead)
+{
+    HE_ASSERT(frames_ahead <= HE_MAX_FRAME_MEMORY_FRAMES_AHEAD);
+
+    U64 frame = memory_system_state.frame.load(std::memory_order_acquire) + frames_ahead;
+    Frame_Memory *frame_memory = &memory_system_state.frame_memories[frame % HE_FRAME_MEMORY_COUNT];
+    // a thread that stalled past the next begin_frame_memory finds the arena already serving a later frame, which
+    // keeps the memory alive for longer.
+    HE_ASSERT(frame_memory->frame.load(std::memory_order_relaxed) >= frame);
+
+    return { .data = frame_memory, .allocate = &frame_memory_allocate, .reallocate = &frame_memory_reallocate, .deallocate = &frame_memory_deallocate, .allocate_uninitialized = &frame_memory_allocate_uninitialized };
+}
+
+static void release_memory_arena(Memory_Arena *arena);
+
+void begin_frame_memory(U32 frames_in_flight)
+{
+    HE_ASSERT(frames_in_flight && frames_in_flight <= HE_MAX_FRAMES_IN_FLIGHT);
+
+    // other threads keep grabbing memory for the previous frame until the new one is published at the end.
+    U64 frame = memory_system_state.frame.load(std::memory_order_relaxed) + 1;
+
+    for (U32 frame_index = 0; frame_index < HE_FRAME_MEMORY_COUNT; frame_index++)
+    {
+        Frame_Memory *frame_memory = &memory_system_state.frame_memories[frame_index];
+        Memory_Arena *arena = &frame_memory->arena;
+
+        // frames up to frame - frames_in_flight are retired, the arena moves on to the next frame that maps to its slot.
+        if (frame_memory->frame.load(std::memory_order_relaxed) + frames_in_flight > frame)
+        {
+            continue;
+        }
+
+        platform_lock_mutex(&frame_memory->mutex);
+
+        HE_ASSERT(!arena->temp_count);
+        arena->offset = 0;
+        arena->stats.live_bytes = 0;
+        arena->stats.allocation_count = 0;
+        release_memory_arena(arena);
+        frame_memory->frame.fetch_add(HE_FRAME_MEMORY_COUNT, std::memory_order_relaxed);
+
+        platform_unlock_mutex(&frame_memory->mutex);
+    }
+
+    memory_system_state.frame.store(frame, std::memory_order_release);
+}
+
 //
 // Memory Arena
 //
 
-bool init_memory_arena(Memory_Arena *arena, U64 capacity, U64 min_allocation_size)
+// alignment has to be a power of two.
+HE_FORCE_INLINE static U64 align_up(U64 value, U64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool init_memory_arena(Memory_Arena *arena, U64 capacity, U64 min_allocation_size, Memory_Arena_Flags flags)
 {
     HE_ASSERT(capacity >= min_allocation_size);
 
-    void *memory = platform_reserve_memory(capacity);
-    if (!memory)
+    void *memory = nullptr;
+
+    if (flags & MemoryArenaFlag_LargePages)
     {
-        return false;
+        U64 large_page_size = platform_get_large_page_size();
+        if (large_page_size)
+        {
+            U64 commit_size = ((min_allocation_size + large_page_size - 1) / large_page_size) * large_page_size;
+            if (commit_size <= capacity)
+            {
+                memory = platform_reserve_memory_with_large_pages(capacity, commit_size);
+                if (memory)
+                {
+                    // the large pages can't be decommited so trimming never goes below them.
+                    min_allocation_size = commit_size;
+                }
+            }
+        }
     }
 
-    if (!platform_commit_memory(memory, min_allocation_size))
+    if (!memory)
     {
-        return false;
+        memory = platform_reserve_memory(capacity);
+        if (!memory)
+        {
+            return false;
+        }
+
+        if (!platform_commit_memory(memory, min_allocation_size))
+        {
+            return false;
+        }
     }
 
     arena->base = (U8 *)memory;
@@ -203,52 +709,126 @@ bool init_memory_arena(Memory_Arena *arena, U64 capacity, U64 min_allocation_siz
     arena->size = min_allocation_size;
     arena->offset = 0;
     arena->temp_count = 0;
+    arena->peak_offset = 0;
+    arena->decommit_threshold = 0;
+    arena->trim_peak_offset = 0;
+    arena->release_count = 0;
+    zero_memory(&arena->stats, sizeof(arena->stats));
 
     return true;
 }
 
-HE_FORCE_INLINE static bool is_power_of_2(U16 value)
+void deinit_memory_arena(Memory_Arena *arena)
 {
-    return (value & (value - 1)) == 0;
+    HE_ASSERT(arena);
+    HE_ASSERT(arena->base);
+
+    platform_deallocate_memory(arena->base);
+    arena->base = nullptr;
+    arena->capacity = 0;
+    arena->size = 0;
+    arena->offset = 0;
 }
 
-U64 get_number_of_bytes_to_align_address(uintptr_t address, U16 alignment)
+void trim_memory_arena(Memory_Arena *arena)
 {
-    U64 result = 0;
+    HE_ASSERT(arena);
 
-    if (alignment)
+    U64 peak_offset = HE_MAX(arena->peak_offset, arena->offset);
+    U64 min_allocation_size = arena->min_allocation_size;
+    U64 keep_size = HE_MAX((peak_offset + min_allocation_size - 1) / min_allocation_size * min_allocation_size, min_allocation_size);
+
+    if (arena->size > keep_size && arena->size - keep_size > arena->decommit_threshold)
     {
-        HE_ASSERT(is_power_of_2(alignment));
-        U64 modulo = address & (alignment - 1);
-        if (modulo != 0)
-        {
-            result = alignment - modulo;
-        }
+        bool decommited = platform_decommit_memory(arena->base + keep_size, arena->size - keep_size);
+        HE_ASSERT(decommited);
+        arena->size = keep_size;
     }
 
-    return result;
+    arena->peak_offset = arena->offset;
 }
 
-void* allocate(Memory_Arena *arena, U64 size, U16 alignment)
+// a thread arena emptied after every job would commit and decommit whenever jobs cross the threshold,
+// so the arena only trims after a number of releases down to the highest peak it saw in them.
+static void release_memory_arena(Memory_Arena *arena)
 {
-    HE_ASSERT(arena);
-    HE_ASSERT(size);
-    void *result = 0;
-    U8 *cursor = arena->base + arena->offset;
-    U64 padding = get_number_of_bytes_to_align_address((uintptr_t)cursor, alignment);
-    U64 allocation_size = size + padding;
+    arena->trim_peak_offset = HE_MAX(arena->trim_peak_offset, HE_MAX(arena->peak_offset, arena->offset));
+    arena->peak_offset = arena->offset;
+
+    arena->release_count++;
+    if (arena->release_count < HE_MEMORY_ARENA_TRIM_PERIOD)
+    {
+        return;
+    }
+
+    arena->peak_offset = arena->trim_peak_offset;
+    trim_memory_arena(arena);
+    arena->trim_peak_offset = 0;
+    arena->release_count = 0;
+}
+
+HE_FORCE_INLINE static bool is_power_of_2(U16 value)
+{
+    return (value & (value - 1)) == 0;
+}
+
+U64 get_number_of_bytes_to_align_address(uintptr_t address, U16 alignment)
+{
+    U64 result = 0;
+
+    if (alignment)
+    {
+        HE_ASSERT(is_power_of_2(alignment));
+        U64 modulo = address & (alignment - 1);
+        if (modulo != 0)
+        {
+            result = alignment - modulo;
+        }
+    }
+
+    return result;
+}
 
-    if (arena->offset + allocation_size > arena->size)
+// commits at least min_allocation_size at a time so the arena doesn't commit page by page.
+static void commit_memory_arena(Memory_Arena *arena, U64 size)
+{
+    if (size <= arena->size)
     {
-        U64 commit_size = HE_MAX(allocation_size, arena->min_allocation_size);
-        HE_ASSERT(arena->size + commit_size <= arena->capacity);
-        bool commited = platform_commit_memory(arena->base + arena->size, commit_size);
-        HE_ASSERT(commited);
-        arena->size += commit_size;
+        return;
     }
 
+    U64 commit_size = HE_MAX(size - arena->size, arena->min_allocation_size);
+    HE_ASSERT(arena->size + commit_size <= arena->capacity);
+    bool commited = platform_commit_memory(arena->base + arena->size, commit_size);
+    HE_ASSERT(commited);
+    arena->size += commit_size;
+}
+
+void* allocate_uninitialized(Memory_Arena *arena, U64 size, U16 alignment)
+{
+    HE_ASSERT(arena);
+    HE_ASSERT(size);
+    void *result = 0;
+    U8 *cursor = arena->base + arena->offset;
+    U64 padding = get_number_of_bytes_to_align_address((uintptr_t)cursor, alignment);
+    U64 allocation_size = size + padding;
+
+    commit_memory_arena(arena, arena->offset + allocation_size);
+
     result = cursor + padding;
     arena->offset += allocation_size;
+    arena->peak_offset = HE_MAX(arena->peak_offset, arena->offset);
+
+    arena->stats.live_bytes = arena->offset;
+    arena->stats.peak_bytes = HE_MAX(arena->stats.peak_bytes, arena->offset);
+    arena->stats.allocation_count++;
+    arena->stats.allocated_bytes += allocation_size;
+    return result;
+}
+
+void* allocate(Memory_Arena *arena, U64 size, U16 alignment)
+{
+    void *result = allocate_uninitialized(arena, size, alignment);
     zero_memory(result, size);
     return result;
 }
@@ -270,13 +850,19 @@ void *reallocate(Memory_Arena *arena, void *memory, U64 old_size, U64 new_size,
     {
         if (new_size > old_size)
         {
+            commit_memory_arena(arena, arena->offset + new_size - old_size);
             arena->offset += new_size - old_size;
+            arena->peak_offset = HE_MAX(arena->peak_offset, arena->offset);
+            arena->stats.allocated_bytes += new_size - old_size;
         }
         else
         {
             arena->offset -= old_size - new_size;
         }
 
+        arena->stats.live_bytes = arena->offset;
+        arena->stats.peak_bytes = HE_MAX(arena->stats.peak_bytes, arena->offset);
+
         return memory;
     }
     
@@ -304,6 +890,11 @@ void memory_arena_deallocate(void *memory_arena, void *memory)
     return deallocate((Memory_Arena *)memory_arena, memory);
 }
 
+void *memory_arena_allocate_uninitialized(void *memory_arena, U64 size, U16 alignment)
+{
+    return allocate_uninitialized((Memory_Arena *)memory_arena, size, alignment);
+}
+
 //
 // Temprary Memory
 //
@@ -322,99 +913,291 @@ void end_temprary_memory(Temprary_Memory temprary_memory)
     HE_ASSERT(arena->temp_count);
     arena->temp_count--;
     arena->offset = temprary_memory.offset;
+    arena->stats.live_bytes = arena->offset;
+
+    if (!arena->temp_count && arena->decommit_threshold)
+    {
+        release_memory_arena(arena);
+    }
 }
 
 //
 // Free List Allocator
 //
 
-static size_t calc_padding_with_header(uintptr_t ptr, uintptr_t alignment, uintptr_t header_size)
+#define HE_FREE_LIST_BLOCK_FREE_BIT 1ull
+#define HE_FREE_LIST_BLOCK_TAG_SHIFT 40
+#define HE_FREE_LIST_BLOCK_SIZE_CLASS_SHIFT 48
+#define HE_FREE_LIST_BLOCK_OWNER_SHIFT 56
+#define HE_FREE_LIST_BLOCK_SIZE_MASK (((1ull << HE_FREE_LIST_BLOCK_TAG_SHIFT) - 1) & ~HE_FREE_LIST_BLOCK_FREE_BIT)
+#define HE_FREE_LIST_BLOCK_TAG_MASK (0xFFull << HE_FREE_LIST_BLOCK_TAG_SHIFT)
+#define HE_FREE_LIST_MAX_CAPACITY (1ull << (HE_FREE_LIST_FIRST_LEVEL_MAX + 1))
+#define HE_FREE_LIST_BLOCK_HEADER_SIZE offsetof(Free_List_Block, next_free_block)
+#define HE_FREE_LIST_MIN_BLOCK_SIZE sizeof(Free_List_Block)
+#define HE_FREE_LIST_SMALL_BLOCK_SIZE (1ull << HE_FREE_LIST_FIRST_LEVEL_SHIFT)
+
+static_assert(HE_FREE_LIST_BLOCK_HEADER_SIZE == (1ull << HE_FREE_LIST_ALIGNMENT_LOG2));
+static_assert(HE_FREE_LIST_FIRST_LEVEL_COUNT <= 64);
+static_assert(HE_FREE_LIST_FIRST_LEVEL_MAX < HE_FREE_LIST_BLOCK_TAG_SHIFT);
+static_assert((U32)Memory_Tag::COUNT <= 0xFF);
+static_assert(HE_FREE_LIST_MAX_THREAD_CACHE_COUNT < (1 << (64 - HE_FREE_LIST_BLOCK_OWNER_SHIFT)));
+
+HE_FORCE_INLINE static U64 get_block_size(Free_List_Block *block)
+{
+    return block->size & HE_FREE_LIST_BLOCK_SIZE_MASK;
+}
+
+// one based index of the thread cache that owns the block, zero if the block belongs to the shared heap.
+HE_FORCE_INLINE static U32 get_block_owner(Free_List_Block *block)
+{
+    return (U32)(block->size >> HE_FREE_LIST_BLOCK_OWNER_SHIFT);
+}
+
+HE_FORCE_INLINE static U32 get_block_size_class(Free_List_Block *block)
+{
+    return (U32)(block->size >> HE_FREE_LIST_BLOCK_SIZE_CLASS_SHIFT) & 0xFF;
+}
+
+HE_FORCE_INLINE static Memory_Tag get_block_tag(Free_List_Block *block)
+{
+    return (Memory_Tag)((block->size & HE_FREE_LIST_BLOCK_TAG_MASK) >> HE_FREE_LIST_BLOCK_TAG_SHIFT);
+}
+
+// blocks held by thread caches get their tag written without the mutex while a neighbour may be coalescing,
+// so the tag store and the neighbour free checks are atomic.
+HE_FORCE_INLINE static void set_block_tag(Free_List_Block *block, Memory_Tag tag)
+{
+    std::atomic_ref< U64 > size(block->size);
+    size.store((size.load(std::memory_order_relaxed) & ~HE_FREE_LIST_BLOCK_TAG_MASK) | ((U64)tag << HE_FREE_LIST_BLOCK_TAG_SHIFT), std::memory_order_relaxed);
+}
+
+HE_FORCE_INLINE static bool is_block_free(Free_List_Block *block)
+{
+    return (block->size & HE_FREE_LIST_BLOCK_FREE_BIT) != 0;
+}
+
+HE_FORCE_INLINE static bool is_neighbour_block_free(Free_List_Block *block)
+{
+    return (std::atomic_ref< U64 >(block->size).load(std::memory_order_relaxed) & HE_FREE_LIST_BLOCK_FREE_BIT) != 0;
+}
+
+HE_FORCE_INLINE static Free_List_Block* get_next_physical_block(Free_List_Block *block)
+{
+    return (Free_List_Block *)((U8 *)block + get_block_size(block));
+}
+
+HE_FORCE_INLINE static void* block_to_memory(Free_List_Block *block)
 {
-    HE_ASSERT(is_power_of_2((U16)alignment));
-    uintptr_t modulo = ptr & (alignment - 1); // same as ptr % alignment
+    return (U8 *)block + HE_FREE_LIST_BLOCK_HEADER_SIZE;
+}
+
+HE_FORCE_INLINE static Free_List_Block* memory_to_block(void *memory)
+{
+    return (Free_List_Block *)((U8 *)memory - HE_FREE_LIST_BLOCK_HEADER_SIZE);
+}
+
+// index of the highest set bit, lzcnt decodes as bsr on cpus without it and gives the wrong answer so leave the
+// choice of instruction to the compiler.
+HE_FORCE_INLINE static U32 find_last_set(U64 value)
+{
+    HE_ASSERT(value);
+    return 63 - (U32)std::countl_zero(value);
+}
+
+static void map_size_to_free_list(U64 size, U32 *out_first_level, U32 *out_second_level)
+{
+    U32 first_level = 0;
+    U32 second_level = 0;
 
-    uintptr_t padding = 0;
-    if (modulo != 0)
+    if (size < HE_FREE_LIST_SMALL_BLOCK_SIZE)
+    {
+        second_level = (U32)(size >> HE_FREE_LIST_ALIGNMENT_LOG2);
+    }
+    else
     {
-        padding = alignment - modulo;
+        U32 last_set = find_last_set(size);
+        second_level = (U32)(size >> (last_set - HE_FREE_LIST_SECOND_LEVEL_COUNT_LOG2)) ^ HE_FREE_LIST_SECOND_LEVEL_COUNT;
+        first_level = last_set - (HE_FREE_LIST_FIRST_LEVEL_SHIFT - 1);
     }
 
-    uintptr_t needed = header_size;
-    if (padding < needed)
+    HE_ASSERT(first_level < HE_FREE_LIST_FIRST_LEVEL_COUNT);
+    *out_first_level = first_level;
+    *out_second_level = second_level;
+}
+
+static void insert_free_block(Free_List_Allocator *allocator, Free_List_Block *block)
+{
+    U32 first_level;
+    U32 second_level;
+    map_size_to_free_list(get_block_size(block), &first_level, &second_level);
+
+    Free_List_Block *head = allocator->free_blocks[first_level][second_level];
+    block->next_free_block = head;
+    block->prev_free_block = nullptr;
+    if (head)
     {
-        needed -= padding;
-        if ((needed & (alignment - 1)) == 0)
-        {
-            padding += alignment * (needed / alignment);
-        }
-        else
-        {
-            padding += alignment * (1 + (needed / alignment));
-        }
+        head->prev_free_block = block;
     }
-    return padding;
+
+    allocator->free_blocks[first_level][second_level] = block;
+    allocator->first_level_bitmap |= 1ull << first_level;
+    allocator->second_level_bitmaps[first_level] |= 1u << second_level;
 }
 
-static void insert_node(Free_List_Allocator *allocator, Free_List_Node *prev_node, Free_List_Node *new_node)
+static void remove_free_block(Free_List_Allocator *allocator, Free_List_Block *block)
 {
-    if (prev_node)
+    U32 first_level;
+    U32 second_level;
+    map_size_to_free_list(get_block_size(block), &first_level, &second_level);
+
+    if (block->prev_free_block)
     {
-        if (prev_node->next)
-        {
-            new_node->next = prev_node->next;
-            prev_node->next = new_node;
-        }
-        else
+        block->prev_free_block->next_free_block = block->next_free_block;
+    }
+    else
+    {
+        HE_ASSERT(allocator->free_blocks[first_level][second_level] == block);
+        allocator->free_blocks[first_level][second_level] = block->next_free_block;
+
+        if (!block->next_free_block)
         {
-            prev_node->next = new_node;
-            new_node->next = nullptr;
+            allocator->second_level_bitmaps[first_level] &= ~(1u << second_level);
+            if (!allocator->second_level_bitmaps[first_level])
+            {
+                allocator->first_level_bitmap &= ~(1ull << first_level);
+            }
         }
     }
-    else
+
+    if (block->next_free_block)
+    {
+        block->next_free_block->prev_free_block = block->prev_free_block;
+    }
+}
+
+// rounds up to the next second level range so that any block in the list of the rounded size is big enough.
+HE_FORCE_INLINE static U64 get_free_list_search_size(U64 size)
+{
+    if (size >= HE_FREE_LIST_SMALL_BLOCK_SIZE)
     {
-        new_node->next = allocator->head;
-        allocator->head = new_node;
+        size += (1ull << (find_last_set(size) - HE_FREE_LIST_SECOND_LEVEL_COUNT_LOG2)) - 1;
     }
 
-    HE_ASSERT(allocator->head->size);
+    return size;
 }
 
-static void remove_node(Free_List_Allocator *allocator, Free_List_Node *prev_node, Free_List_Node *node)
+// finds a free block that is at least size bytes or null if there is none.
+static Free_List_Block* find_free_block(Free_List_Allocator *allocator, U64 size)
 {
-    if (prev_node)
+    size = get_free_list_search_size(size);
+
+    if (find_last_set(size) > HE_FREE_LIST_FIRST_LEVEL_MAX)
     {
-        prev_node->next = node->next;
+        return nullptr;
     }
-    else
+
+    U32 first_level;
+    U32 second_level;
+    map_size_to_free_list(size, &first_level, &second_level);
+
+    U32 second_level_bitmap = allocator->second_level_bitmaps[first_level] & (~0u << second_level);
+    if (!second_level_bitmap)
+    {
+        U64 first_level_bitmap = allocator->first_level_bitmap & (~0ull << (first_level + 1));
+        if (!first_level_bitmap)
+        {
+            return nullptr;
+        }
+
+        first_level = (U32)_tzcnt_u64(first_level_bitmap);
+        second_level_bitmap = allocator->second_level_bitmaps[first_level];
+    }
+
+    second_level = (U32)_tzcnt_u32(second_level_bitmap);
+    return allocator->free_blocks[first_level][second_level];
+}
+
+// marks the block as free merging it with its free physical neighbours.
+static void release_block(Free_List_Allocator *allocator, Free_List_Block *block)
+{
+    Free_List_Block *prev_block = block->prev_physical_block;
+    if (prev_block && is_neighbour_block_free(prev_block))
+    {
+        remove_free_block(allocator, prev_block);
+        prev_block->size += get_block_size(block);
+        block = prev_block;
+    }
+
+    Free_List_Block *next_block = get_next_physical_block(block);
+    if (is_neighbour_block_free(next_block))
+    {
+        remove_free_block(allocator, next_block);
+        block->size += get_block_size(next_block);
+    }
+
+    block->size |= HE_FREE_LIST_BLOCK_FREE_BIT;
+    get_next_physical_block(block)->prev_physical_block = block;
+    insert_free_block(allocator, block);
+}
+
+// splits the tail of an allocated block beyond size into a free block if it is big enough.
+static void trim_block(Free_List_Allocator *allocator, Free_List_Block *block, U64 size)
+{
+    U64 block_size = get_block_size(block);
+    if (block_size - size < HE_FREE_LIST_MIN_BLOCK_SIZE)
     {
-        allocator->head = node->next;
+        return;
     }
 
-    HE_ASSERT(allocator->head->size);
+    Free_List_Block *remaining_block = (Free_List_Block *)((U8 *)block + size);
+    remaining_block->prev_physical_block = block;
+    remaining_block->size = block_size - size;
+    block->size = (block->size & ~HE_FREE_LIST_BLOCK_SIZE_MASK) | size;
+    release_block(allocator, remaining_block);
 }
 
-static void merge(Free_List_Allocator *allocator, Free_List_Node *prev_node, Free_List_Node *node)
+static bool grow_free_list_allocator(Free_List_Allocator *allocator, U64 size)
 {
-    if (node->next && (U8 *)node + node->size == (U8 *)node->next)
+    U64 commit_size = HE_MIN(HE_MAX(size + HE_FREE_LIST_BLOCK_HEADER_SIZE, allocator->min_allocation_size), allocator->capacity - allocator->size);
+    if (commit_size < size + HE_FREE_LIST_BLOCK_HEADER_SIZE)
     {
-        node->size += node->next->size;
-        remove_node(allocator, node, node->next);
+        return false;
     }
 
-    if (prev_node && prev_node->next && (U8 *)prev_node + prev_node->size == (U8 *)node)
+    if (!platform_commit_memory(allocator->base + allocator->size, commit_size))
     {
-        prev_node->size += node->size;
-        remove_node(allocator, prev_node, node);
+        return false;
     }
 
-    HE_ASSERT(allocator->head->size);
+    allocator->size += commit_size;
+
+    // the old sentinel becomes the header of the new block.
+    Free_List_Block *block = allocator->sentinel_block;
+    U8 *end = allocator->base + allocator->size;
+    block->size = ((end - (U8 *)block) - HE_FREE_LIST_BLOCK_HEADER_SIZE) & ~(HE_FREE_LIST_BLOCK_HEADER_SIZE - 1);
+
+    Free_List_Block *sentinel_block = get_next_physical_block(block);
+    sentinel_block->prev_physical_block = block;
+    sentinel_block->size = 0;
+    allocator->sentinel_block = sentinel_block;
+
+    release_block(allocator, block);
+    return true;
 }
 
-bool init_free_list_allocator(Free_List_Allocator *allocator, void *memory, U64 capacity, U64 size, const char *debug_name)
+// every free list allocator is listed in the memory snapshots.
+static Free_List_Allocator *free_list_allocators[16];
+static std::atomic< U32 > free_list_allocator_count;
+
+bool init_free_list_allocator(Free_List_Allocator *allocator, void *memory, U64 capacity, U64 size, const char *debug_name, bool use_thread_caches)
 {
     HE_ASSERT(allocator);
-    HE_ASSERT(size >= sizeof(Free_List_Node));
+    HE_ASSERT(size >= HE_FREE_LIST_MIN_BLOCK_SIZE + HE_FREE_LIST_BLOCK_HEADER_SIZE);
     HE_ASSERT(capacity >= size);
+    HE_ASSERT(size <= HE_FREE_LIST_MAX_CAPACITY);
+
+    // blocks can't be bigger than the block size bits allow.
+    capacity = HE_MIN(capacity, HE_FREE_LIST_MAX_CAPACITY);
 
     if (!memory)
     {
@@ -431,17 +1214,40 @@ bool init_free_list_allocator(Free_List_Allocator *allocator, void *memory, U64
         }
     }
 
+    HE_ASSERT(((uintptr_t)memory & (HE_FREE_LIST_BLOCK_HEADER_SIZE - 1)) == 0);
+
     allocator->base = (U8 *)memory;
     allocator->capacity = capacity;
     allocator->min_allocation_size = size;
     allocator->size = size;
-    allocator->used = 0;
     allocator->debug_name = debug_name;
+    zero_memory(&allocator->stats, sizeof(allocator->stats));
+
+    allocator->first_level_bitmap = 0;
+    zero_memory(allocator->second_level_bitmaps, sizeof(allocator->second_level_bitmaps));
+    zero_memory(allocator->free_blocks, sizeof(allocator->free_blocks));
+    allocator->use_thread_caches = use_thread_caches;
+    zero_memory(allocator->thread_caches, sizeof(allocator->thread_caches));
+
+    for (U32 tag_index = 0; tag_index < (U32)Memory_Tag::COUNT; tag_index++)
+    {
+        allocator->tagged_allocators[tag_index] = { .allocator = allocator, .tag = (Memory_Tag)tag_index };
+    }
+
+    U32 free_list_allocator_index = free_list_allocator_count.fetch_add(1, std::memory_order_relaxed);
+    HE_ASSERT(free_list_allocator_index < HE_ARRAYCOUNT(free_list_allocators));
+    free_list_allocators[free_list_allocator_index] = allocator;
+
+    Free_List_Block *first_block = (Free_List_Block *)allocator->base;
+    first_block->prev_physical_block = nullptr;
+    first_block->size = (size - HE_FREE_LIST_BLOCK_HEADER_SIZE) & ~(HE_FREE_LIST_BLOCK_HEADER_SIZE - 1);
+
+    Free_List_Block *sentinel_block = get_next_physical_block(first_block);
+    sentinel_block->prev_physical_block = first_block;
+    sentinel_block->size = 0;
+    allocator->sentinel_block = sentinel_block;
 
-    Free_List_Node *first_free_node = (Free_List_Node *)allocator->base;
-    first_free_node->size = size;
-    first_free_node->next = nullptr;
-    allocator->head = first_free_node;
+    release_block(allocator, first_block);
 
     bool mutex_created = platform_create_mutex(&allocator->mutex);
     HE_ASSERT(mutex_created);
@@ -449,66 +1255,80 @@ bool init_free_list_allocator(Free_List_Allocator *allocator, void *memory, U64
     return true;
 }
 
-struct Free_List_Allocation_Header
+static U64 get_required_block_size(U64 size)
 {
-    U64 size;
-    U64 padding;
-};
-
-static_assert(sizeof(Free_List_Allocation_Header) == sizeof(Free_List_Node));
+    return HE_MAX(align_up(size, HE_FREE_LIST_BLOCK_HEADER_SIZE) + HE_FREE_LIST_BLOCK_HEADER_SIZE, HE_FREE_LIST_MIN_BLOCK_SIZE);
+}
 
-static void* allocate_internal(Free_List_Allocator *allocator, U64 size, U16 alignment)
+static Free_List_Block* allocate_block(Free_List_Allocator *allocator, U64 size, U16 alignment)
 {
     HE_ASSERT(allocator);
     HE_ASSERT(size);
+    HE_ASSERT(is_power_of_2(alignment));
 
-    Free_List_Node *alloc_node = nullptr;
-    Free_List_Node *prev_node = nullptr;
-    U64 padding = 0;
-    U64 required_size = 0;
+    U64 required_size = get_required_block_size(size);
 
-    for (Free_List_Node *node = allocator->head; node; node = node->next)
+    // over aligned allocations search for enough slack to split off a leading free block.
+    U64 search_size = required_size;
+    if (alignment > HE_FREE_LIST_BLOCK_HEADER_SIZE)
     {
-        padding = calc_padding_with_header((uintptr_t)node, (uintptr_t)alignment, sizeof(Free_List_Allocation_Header));
-        required_size = size + padding;
+        search_size += alignment + HE_FREE_LIST_MIN_BLOCK_SIZE;
+    }
 
-        if (node->size >= required_size)
-        {
-            alloc_node = node;
-            break;
-        }
+    Free_List_Block *block = find_free_block(allocator, search_size);
 
-        prev_node = node;
+    // the new block has to reach the list the search starts from, not just fit search_size.
+    if (!block && grow_free_list_allocator(allocator, get_free_list_search_size(search_size)))
+    {
+        block = find_free_block(allocator, search_size);
     }
 
-    HE_ASSERT(alloc_node);
-
-    U64 remaining = alloc_node->size - required_size;
-    if (remaining > sizeof(Free_List_Node))
+    if (!block)
     {
-        Free_List_Node *new_node = (Free_List_Node *)((U8 *)alloc_node + required_size);
-        new_node->size = remaining;
-        insert_node(allocator, alloc_node, new_node);
+        return nullptr;
     }
 
-    remove_node(allocator, prev_node, alloc_node);
+    remove_free_block(allocator, block);
+    block->size &= ~HE_FREE_LIST_BLOCK_FREE_BIT;
 
-    Free_List_Allocation_Header *header = (Free_List_Allocation_Header *)((U8 *)alloc_node + padding - sizeof(Free_List_Allocation_Header));
-    header->size = required_size;
-    header->padding = padding;
+    if (alignment > HE_FREE_LIST_BLOCK_HEADER_SIZE)
+    {
+        uintptr_t memory = (uintptr_t)block_to_memory(block);
+        U64 gap = align_up(memory, alignment) - memory;
+        if (gap && gap < HE_FREE_LIST_MIN_BLOCK_SIZE)
+        {
+            gap = align_up(memory + HE_FREE_LIST_MIN_BLOCK_SIZE, alignment) - memory;
+        }
 
-    allocator->used += required_size;
+        if (gap)
+        {
+            Free_List_Block *aligned_block = (Free_List_Block *)((U8 *)block + gap);
+            aligned_block->prev_physical_block = block;
+            aligned_block->size = get_block_size(block) - gap;
+            get_next_physical_block(aligned_block)->prev_physical_block = aligned_block;
+
+            // the previous physical block of a free block is never free so it doesn't need merging.
+            block->size = gap | HE_FREE_LIST_BLOCK_FREE_BIT;
+            insert_free_block(allocator, block);
+            block = aligned_block;
+        }
+    }
 
-    void *result = (void *)((U8 *)alloc_node + padding);
-    zero_memory(result, size);
-    return result;
+    trim_block(allocator, block, required_size);
+    record_allocation(&allocator->stats, get_block_size(block));
+    return block;
 }
 
-void* allocate(Free_List_Allocator *allocator, U64 size, U16 alignment)
+static void* allocate_internal(Free_List_Allocator *allocator, U64 size, U16 alignment)
 {
-    platform_lock_mutex(&allocator->mutex);
-    void *result = allocate_internal(allocator, size, alignment);
-    platform_unlock_mutex(&allocator->mutex);
+    Free_List_Block *block = allocate_block(allocator, size, alignment);
+    if (!block)
+    {
+        return nullptr;
+    }
+
+    void *result = block_to_memory(block);
+    zero_memory(result, size);
     return result;
 }
 
@@ -521,87 +1341,1044 @@ static void deallocate_internal(Free_List_Allocator *allocator, void *memory)
 
     HE_ASSERT((U8*)memory >= allocator->base && (U8*)memory <= allocator->base + allocator->size);
 
-    Free_List_Allocation_Header *header = (Free_List_Allocation_Header *)((U8*)memory - sizeof(Free_List_Allocation_Header));
+    Free_List_Block *block = memory_to_block(memory);
+    HE_ASSERT(!is_block_free(block));
+    HE_ASSERT(!get_block_owner(block));
+    HE_ASSERT(get_block_size(block) >= HE_FREE_LIST_MIN_BLOCK_SIZE);
+
+    block->size &= HE_FREE_LIST_BLOCK_SIZE_MASK;
+    record_deallocation(&allocator->stats, get_block_size(block));
+    release_block(allocator, block);
+}
+
+//
+// Free List Thread Cache
+//
+
+// small classes step by the allocator granularity, medium classes step by HE_FREE_LIST_MEDIUM_SIZE_CLASS_STEP.
+#define HE_FREE_LIST_SMALL_SIZE_CLASS_COUNT 64
+#define HE_FREE_LIST_MEDIUM_SIZE_CLASS_COUNT 28
+#define HE_FREE_LIST_SIZE_CLASS_COUNT (HE_FREE_LIST_SMALL_SIZE_CLASS_COUNT + HE_FREE_LIST_MEDIUM_SIZE_CLASS_COUNT)
+#define HE_FREE_LIST_SMALL_SIZE_CLASS_MAX_BLOCK_SIZE (HE_FREE_LIST_MIN_BLOCK_SIZE + (HE_FREE_LIST_SMALL_SIZE_CLASS_COUNT - 1) * HE_FREE_LIST_BLOCK_HEADER_SIZE)
+#define HE_FREE_LIST_MEDIUM_SIZE_CLASS_STEP 256
+#define HE_FREE_LIST_SMALL_SIZE_CLASS_CAPACITY 32
+#define HE_FREE_LIST_MEDIUM_SIZE_CLASS_CAPACITY 8
+
+struct Free_List_Size_Class_Cache
+{
+    U32 count;
+    Free_List_Block *blocks[HE_FREE_LIST_SMALL_SIZE_CLASS_CAPACITY];
+};
 
-    HE_ASSERT(header->padding >= sizeof(Free_List_Allocation_Header));
-    HE_ASSERT(header->size > 0);
+struct Free_List_Thread_Cache
+{
+    U32 owner;
+    std::atomic< Free_List_Block * > remote_free_blocks; // blocks owned by this cache that were freed by other threads.
+    Free_List_Size_Class_Cache size_classes[HE_FREE_LIST_SIZE_CLASS_COUNT];
+};
 
-    U64 size = header->size;
-    U64 padding = header->padding;
+static std::atomic< U32 > free_list_thread_count;
+static thread_local U32 free_list_thread_owner; // one based, zero until the thread first uses a thread cache.
 
-    Free_List_Node *free_node = (Free_List_Node *)((U8 *)memory - padding);
-    free_node->size = size;
-    free_node->next = nullptr;
+HE_FORCE_INLINE static U32 get_size_class_capacity(U32 size_class)
+{
+    return size_class < HE_FREE_LIST_SMALL_SIZE_CLASS_COUNT ? HE_FREE_LIST_SMALL_SIZE_CLASS_CAPACITY : HE_FREE_LIST_MEDIUM_SIZE_CLASS_CAPACITY;
+}
 
-    Free_List_Node *prev_node = nullptr;
-    for (Free_List_Node *node = allocator->head; node; node = node->next)
+static U64 get_size_class_block_size(U32 size_class)
+{
+    if (size_class < HE_FREE_LIST_SMALL_SIZE_CLASS_COUNT)
     {
-        if ((U8 *)memory < (U8 *)node)
-        {
-            insert_node(allocator, prev_node, free_node);
-            break;
-        }
-        prev_node = node;
+        return HE_FREE_LIST_MIN_BLOCK_SIZE + size_class * HE_FREE_LIST_BLOCK_HEADER_SIZE;
     }
 
-    allocator->used -= size;
-    merge(allocator, prev_node, free_node);
+    return HE_FREE_LIST_SMALL_SIZE_CLASS_MAX_BLOCK_SIZE + (size_class - HE_FREE_LIST_SMALL_SIZE_CLASS_COUNT + 1) * HE_FREE_LIST_MEDIUM_SIZE_CLASS_STEP;
 }
 
-void deallocate(Free_List_Allocator *allocator, void *memory)
+// smallest size class that fits the block or HE_FREE_LIST_SIZE_CLASS_COUNT if the block is too big to be cached.
+static U32 get_size_class(U64 block_size)
 {
-    platform_lock_mutex(&allocator->mutex);
-    deallocate_internal(allocator, memory);
-    platform_unlock_mutex(&allocator->mutex);
+    if (block_size <= HE_FREE_LIST_SMALL_SIZE_CLASS_MAX_BLOCK_SIZE)
+    {
+        return (U32)((block_size - HE_FREE_LIST_MIN_BLOCK_SIZE) / HE_FREE_LIST_BLOCK_HEADER_SIZE);
+    }
+
+    U64 medium_size_class = (block_size - HE_FREE_LIST_SMALL_SIZE_CLASS_MAX_BLOCK_SIZE + HE_FREE_LIST_MEDIUM_SIZE_CLASS_STEP - 1) / HE_FREE_LIST_MEDIUM_SIZE_CLASS_STEP - 1;
+    return (U32)HE_MIN(HE_FREE_LIST_SMALL_SIZE_CLASS_COUNT + medium_size_class, HE_FREE_LIST_SIZE_CLASS_COUNT);
 }
 
-void* reallocate(Free_List_Allocator *allocator, void *memory, U64 _, U64 new_size, U16 alignment)
+static Free_List_Thread_Cache* get_thread_cache(Free_List_Allocator *allocator)
 {
-    if (!memory)
+    U32 owner = free_list_thread_owner;
+    if (!owner)
+    {
+        owner = free_list_thread_count.fetch_add(1, std::memory_order_relaxed) + 1;
+        free_list_thread_owner = owner;
+    }
+
+    // threads past the limit always go through the shared heap.
+    if (owner > HE_FREE_LIST_MAX_THREAD_CACHE_COUNT)
+    {
+        return nullptr;
+    }
+
+    // only the owner thread creates its cache, other threads only see it through blocks it tagged.
+    Free_List_Thread_Cache *thread_cache = allocator->thread_caches[owner - 1];
+    if (!thread_cache)
     {
         platform_lock_mutex(&allocator->mutex);
-        void *result = allocate_internal(allocator, new_size, alignment);
+        thread_cache = (Free_List_Thread_Cache *)allocate_internal(allocator, sizeof(Free_List_Thread_Cache), alignof(Free_List_Thread_Cache));
         platform_unlock_mutex(&allocator->mutex);
-        return result;
-    }
 
-    platform_lock_mutex(&allocator->mutex);
+        if (!thread_cache)
+        {
+            return nullptr;
+        }
 
-    HE_ASSERT(allocator);
-    HE_ASSERT(memory >= allocator->base && memory <= allocator->base + allocator->size);
-    HE_ASSERT(new_size);
+        thread_cache->owner = owner;
+        allocator->thread_caches[owner - 1] = thread_cache;
+    }
 
-    Free_List_Allocation_Header header = ((Free_List_Allocation_Header *)memory)[-1];
-    HE_ASSERT(header.size >= 0);
-    HE_ASSERT(header.padding >= 0);
-    HE_ASSERT(header.padding < allocator->size);
-    HE_ASSERT(new_size != header.size);
+    return thread_cache;
+}
+
+// returns a linked list of cached blocks to the shared heap under a single lock.
+static void release_thread_cache_blocks(Free_List_Allocator *allocator, Free_List_Block *blocks)
+{
+    platform_lock_mutex(&allocator->mutex);
 
-    U64 old_size = header.size - header.padding;
-    if (old_size == new_size)
+    while (blocks)
     {
-        return memory;
+        Free_List_Block *next_block = blocks->next_free_block;
+        blocks->size &= HE_FREE_LIST_BLOCK_SIZE_MASK;
+        record_deallocation(&allocator->stats, get_block_size(blocks));
+        release_block(allocator, blocks);
+        blocks = next_block;
     }
-    
-    void *new_memory = allocate_internal(allocator, new_size, alignment);
-    copy_memory(new_memory, memory, old_size);
-    deallocate_internal(allocator, memory);
-    platform_unlock_mutex(&allocator->mutex);
 
-    return new_memory;
+    platform_unlock_mutex(&allocator->mutex);
 }
 
-void *free_list_allocator_allocate(void *free_list_allocator, U64 size, U16 alignment)
+static void push_to_thread_cache(Free_List_Allocator *allocator, Free_List_Thread_Cache *thread_cache, Free_List_Block *block)
 {
-    return allocate((Free_List_Allocator *)free_list_allocator, size, alignment);
+    U32 size_class = get_block_size_class(block);
+    Free_List_Size_Class_Cache *size_class_cache = &thread_cache->size_classes[size_class];
+    U32 capacity = get_size_class_capacity(size_class);
+
+    if (size_class_cache->count == capacity)
+    {
+        // drain the coldest half of the cache.
+        U32 drain_count = capacity / 2;
+        Free_List_Block *blocks = nullptr;
+
+        for (U32 block_index = 0; block_index < drain_count; block_index++)
+        {
+            Free_List_Block *drained_block = size_class_cache->blocks[block_index];
+            drained_block->next_free_block = blocks;
+            blocks = drained_block;
+        }
+
+        for (U32 block_index = drain_count; block_index < capacity; block_index++)
+        {
+            size_class_cache->blocks[block_index - drain_count] = size_class_cache->blocks[block_index];
+        }
+
+        size_class_cache->count -= drain_count;
+        release_thread_cache_blocks(allocator, blocks);
+    }
+
+    size_class_cache->blocks[size_class_cache->count++] = block;
 }
 
-void *free_list_allocator_reallocate(void *free_list_allocator, void *memory, U64 old_size, U64 new_size, U16 alignment)
+static void collect_remote_free_blocks(Free_List_Allocator *allocator, Free_List_Thread_Cache *thread_cache)
 {
-    return reallocate((Free_List_Allocator *)free_list_allocator, memory, old_size, new_size, alignment);
+    Free_List_Block *block = thread_cache->remote_free_blocks.exchange(nullptr, std::memory_order_acquire);
+    while (block)
+    {
+        Free_List_Block *next_block = block->next_free_block;
+        push_to_thread_cache(allocator, thread_cache, block);
+        block = next_block;
+    }
 }
 
-void free_list_allocator_deallocate(void *free_list_allocator, void *memory)
+static void* allocate_from_thread_cache(Free_List_Allocator *allocator, Free_List_Thread_Cache *thread_cache, U32 size_class, U64 size, bool zero)
 {
-    return deallocate((Free_List_Allocator *)free_list_allocator, memory);
-}
\ No newline at end of file
+    Free_List_Size_Class_Cache *size_class_cache = &thread_cache->size_classes[size_class];
+
+    if (!size_class_cache->count)
+    {
+        collect_remote_free_blocks(allocator, thread_cache);
+    }
+
+    if (!size_class_cache->count)
+    {
+        // refill half of the cache from the shared heap under a single lock.
+        U64 block_size = get_size_class_block_size(size_class);
+        U32 refill_count = get_size_class_capacity(size_class) / 2;
+        U64 tag = ((U64)thread_cache->owner << HE_FREE_LIST_BLOCK_OWNER_SHIFT) | ((U64)size_class << HE_FREE_LIST_BLOCK_SIZE_CLASS_SHIFT);
+
+        platform_lock_mutex(&allocator->mutex);
+
+        for (U32 block_index = 0; block_index < refill_count; block_index++)
+        {
+            Free_List_Block *block = allocate_block(allocator, block_size - HE_FREE_LIST_BLOCK_HEADER_SIZE, HE_FREE_LIST_BLOCK_HEADER_SIZE);
+            if (!block)
+            {
+                break;
+            }
+
+            block->size |= tag;
+            size_class_cache->blocks[size_class_cache->count++] = block;
+        }
+
+        platform_unlock_mutex(&allocator->mutex);
+
+        if (!size_class_cache->count)
+        {
+            return nullptr;
+        }
+    }
+
+    Free_List_Block *block = size_class_cache->blocks[--size_class_cache->count];
+    void *result = block_to_memory(block);
+    if (zero)
+    {
+        zero_memory(result, size);
+    }
+    return result;
+}
+
+static void* allocate_memory(Free_List_Allocator *allocator, U64 size, U16 alignment, bool zero, Memory_Tag tag)
+{
+    HE_ASSERT(size);
+
+    void *result = nullptr;
+
+    U32 size_class = get_size_class(get_required_block_size(size));
+    Free_List_Thread_Cache *thread_cache = nullptr;
+    if (allocator->use_thread_caches && alignment <= HE_FREE_LIST_BLOCK_HEADER_SIZE && size_class < HE_FREE_LIST_SIZE_CLASS_COUNT)
+    {
+        thread_cache = get_thread_cache(allocator);
+    }
+
+    if (thread_cache)
+    {
+        result = allocate_from_thread_cache(allocator, thread_cache, size_class, size, zero);
+    }
+    else
+    {
+        platform_lock_mutex(&allocator->mutex);
+        Free_List_Block *block = allocate_block(allocator, size, alignment);
+        platform_unlock_mutex(&allocator->mutex);
+
+        if (block)
+        {
+            result = block_to_memory(block);
+            if (zero)
+            {
+                zero_memory(result, size);
+            }
+        }
+    }
+
+    if (!result)
+    {
+        return nullptr;
+    }
+
+    Free_List_Block *block = memory_to_block(result);
+    set_block_tag(block, tag);
+    record_tag_allocation(tag, get_block_size(block));
+    return result;
+}
+
+void* allocate(Free_List_Allocator *allocator, U64 size, U16 alignment)
+{
+    return allocate_memory(allocator, size, alignment, true, thread_memory_tag);
+}
+
+void* allocate(Free_List_Allocator *allocator, U64 size, U16 alignment, Memory_Tag tag)
+{
+    return allocate_memory(allocator, size, alignment, true, tag);
+}
+
+void* allocate_uninitialized(Free_List_Allocator *allocator, U64 size, U16 alignment)
+{
+    return allocate_memory(allocator, size, alignment, false, thread_memory_tag);
+}
+
+void deallocate(Free_List_Allocator *allocator, void *memory)
+{
+    if (!memory)
+    {
+        return;
+    }
+
+    Free_List_Block *block = memory_to_block(memory);
+    record_tag_deallocation(get_block_tag(block), get_block_size(block));
+
+    U32 owner = get_block_owner(block);
+    if (owner)
+    {
+        Free_List_Thread_Cache *thread_cache = allocator->thread_caches[owner - 1];
+        HE_ASSERT(thread_cache);
+
+        if (owner == free_list_thread_owner)
+        {
+            push_to_thread_cache(allocator, thread_cache, block);
+        }
+        else
+        {
+            Free_List_Block *head = thread_cache->remote_free_blocks.load(std::memory_order_relaxed);
+            do
+            {
+                block->next_free_block = head;
+            }
+            while (!thread_cache->remote_free_blocks.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        return;
+    }
+
+    platform_lock_mutex(&allocator->mutex);
+    deallocate_internal(allocator, memory);
+    platform_unlock_mutex(&allocator->mutex);
+}
+
+// the memory keeps its tag when it's moved.
+static void* reallocate_memory(Free_List_Allocator *allocator, void *memory, U64 new_size, U16 alignment, Memory_Tag tag)
+{
+    if (!memory)
+    {
+        return allocate_memory(allocator, new_size, alignment, true, tag);
+    }
+
+    Free_List_Block *block = memory_to_block(memory);
+    tag = get_block_tag(block);
+
+    if (get_block_owner(block))
+    {
+        U64 old_size = get_block_size(block) - HE_FREE_LIST_BLOCK_HEADER_SIZE;
+        if (new_size <= old_size)
+        {
+            return memory;
+        }
+
+        void *new_memory = allocate_memory(allocator, new_size, alignment, true, tag);
+        copy_memory(new_memory, memory, old_size);
+        deallocate(allocator, memory);
+        return new_memory;
+    }
+
+    platform_lock_mutex(&allocator->mutex);
+
+    HE_ASSERT(allocator);
+    HE_ASSERT((U8 *)memory >= allocator->base && (U8 *)memory <= allocator->base + allocator->size);
+    HE_ASSERT(new_size);
+    HE_ASSERT(!is_block_free(block));
+
+    U64 block_size = get_block_size(block);
+    U64 old_size = block_size - HE_FREE_LIST_BLOCK_HEADER_SIZE;
+    U64 required_size = get_required_block_size(new_size);
+
+    // grow in place by taking over the next physical block if it is free.
+    Free_List_Block *next_block = get_next_physical_block(block);
+    if (required_size > block_size && is_neighbour_block_free(next_block) && block_size + get_block_size(next_block) >= required_size)
+    {
+        remove_free_block(allocator, next_block);
+        block->size += get_block_size(next_block);
+        get_next_physical_block(block)->prev_physical_block = block;
+        zero_memory((U8 *)memory + old_size, new_size - old_size);
+    }
+
+    if (required_size <= get_block_size(block))
+    {
+        record_deallocation(&allocator->stats, block_size);
+        trim_block(allocator, block, required_size);
+        record_allocation(&allocator->stats, get_block_size(block));
+
+        platform_unlock_mutex(&allocator->mutex);
+
+        record_tag_deallocation(tag, block_size);
+        record_tag_allocation(tag, get_block_size(block));
+        return memory;
+    }
+
+    Free_List_Block *new_block = allocate_block(allocator, new_size, alignment);
+    if (!new_block)
+    {
+        platform_unlock_mutex(&allocator->mutex);
+        return nullptr;
+    }
+
+    void *new_memory = block_to_memory(new_block);
+    zero_memory(new_memory, new_size);
+    copy_memory(new_memory, memory, old_size);
+    set_block_tag(new_block, tag);
+    deallocate_internal(allocator, memory);
+    platform_unlock_mutex(&allocator->mutex);
+
+    record_tag_deallocation(tag, block_size);
+    record_tag_allocation(tag, get_block_size(new_block));
+    return new_memory;
+}
+
+void* reallocate(Free_List_Allocator *allocator, void *memory, U64 _, U64 new_size, U16 alignment)
+{
+    return reallocate_memory(allocator, memory, new_size, alignment, thread_memory_tag);
+}
+
+void *free_list_allocator_allocate(void *free_list_allocator, U64 size, U16 alignment)
+{
+    return allocate((Free_List_Allocator *)free_list_allocator, size, alignment);
+}
+
+void *free_list_allocator_reallocate(void *free_list_allocator, void *memory, U64 old_size, U64 new_size, U16 alignment)
+{
+    return reallocate((Free_List_Allocator *)free_list_allocator, memory, old_size, new_size, alignment);
+}
+
+void free_list_allocator_deallocate(void *free_list_allocator, void *memory)
+{
+    return deallocate((Free_List_Allocator *)free_list_allocator, memory);
+}
+
+void *free_list_allocator_allocate_uninitialized(void *free_list_allocator, U64 size, U16 alignment)
+{
+    return allocate_uninitialized((Free_List_Allocator *)free_list_allocator, size, alignment);
+}
+
+void *free_list_tagged_allocator_allocate(void *tagged_allocator, U64 size, U16 alignment)
+{
+    Free_List_Tagged_Allocator *allocator = (Free_List_Tagged_Allocator *)tagged_allocator;
+    return allocate_memory(allocator->allocator, size, alignment, true, allocator->tag);
+}
+
+void *free_list_tagged_allocator_reallocate(void *tagged_allocator, void *memory, U64 old_size, U64 new_size, U16 alignment)
+{
+    Free_List_Tagged_Allocator *allocator = (Free_List_Tagged_Allocator *)tagged_allocator;
+    return reallocate_memory(allocator->allocator, memory, new_size, alignment, allocator->tag);
+}
+
+void free_list_tagged_allocator_deallocate(void *tagged_allocator, void *memory)
+{
+    Free_List_Tagged_Allocator *allocator = (Free_List_Tagged_Allocator *)tagged_allocator;
+    deallocate(allocator->allocator, memory);
+}
+
+void *free_list_tagged_allocator_allocate_uninitialized(void *tagged_allocator, U64 size, U16 alignment)
+{
+    Free_List_Tagged_Allocator *allocator = (Free_List_Tagged_Allocator *)tagged_allocator;
+    return allocate_memory(allocator->allocator, size, alignment, false, allocator->tag);
+}
+
+//
+// Slab Allocator
+//
+
+#define HE_SLAB_FIRST_SLOT_OFFSET ((sizeof(Slab) + HE_SLAB_SIZE_CLASS_GRANULARITY - 1) & ~(U64)(HE_SLAB_SIZE_CLASS_GRANULARITY - 1))
+#define HE_SLAB_THREAD_CACHE_CAPACITY 16
+
+struct Slab_Thread_Cache_Bin
+{
+    U32 count;
+    void *slots[HE_SLAB_THREAD_CACHE_CAPACITY];
+};
+
+struct Slab_Thread_Cache
+{
+    Slab_Thread_Cache_Bin bins[HE_SLAB_SIZE_CLASS_COUNT];
+};
+
+static_assert(sizeof(Slab_Thread_Cache) <= HE_SLAB_SIZE);
+static_assert(HE_SLAB_FIRST_SLOT_OFFSET + HE_SLAB_MAX_SLOT_SIZE <= HE_SLAB_SIZE);
+
+static Slab_Allocator *slab_allocators[8];
+static std::atomic< U32 > slab_allocator_count;
+
+bool init_slab_allocator(Slab_Allocator *allocator, U64 capacity, Allocator fallback_allocator, U32 flags, const char *debug_name)
+{
+    HE_ASSERT(allocator);
+    HE_ASSERT(fallback_allocator.data);
+    HE_ASSERT(capacity >= HE_SLAB_SIZE);
+
+    capacity = align_up(capacity, HE_SLAB_SIZE);
+
+    // one more slab to align the base to the slab size.
+    U8 *memory = (U8 *)platform_reserve_memory(capacity + HE_SLAB_SIZE);
+    if (!memory)
+    {
+        return false;
+    }
+
+    allocator->debug_name = debug_name;
+    allocator->base = (U8 *)align_up((uintptr_t)memory, HE_SLAB_SIZE);
+    allocator->capacity = capacity;
+    allocator->flags = flags;
+    allocator->fallback_allocator = fallback_allocator;
+    allocator->slab_count = 0;
+    allocator->free_slabs = nullptr;
+    zero_memory(allocator->thread_caches, sizeof(allocator->thread_caches));
+
+    bool mutex_created = platform_create_mutex(&allocator->slab_mutex);
+    HE_ASSERT(mutex_created);
+
+    for (U32 size_class = 0; size_class < HE_SLAB_SIZE_CLASS_COUNT; size_class++)
+    {
+        Slab_Size_Class *size_class_state = &allocator->size_classes[size_class];
+        size_class_state->partial_slabs = nullptr;
+        zero_memory(&size_class_state->stats, sizeof(size_class_state->stats));
+
+        mutex_created = platform_create_mutex(&size_class_state->mutex);
+        HE_ASSERT(mutex_created);
+    }
+
+    U32 slab_allocator_index = slab_allocator_count.fetch_add(1, std::memory_order_relaxed);
+    HE_ASSERT(slab_allocator_index < HE_ARRAYCOUNT(slab_allocators));
+    slab_allocators[slab_allocator_index] = allocator;
+
+    return true;
+}
+
+HE_FORCE_INLINE static U32 get_slab_size_class(U64 size)
+{
+    return (U32)((HE_MAX(size, 1ull) - 1) / HE_SLAB_SIZE_CLASS_GRANULARITY);
+}
+
+HE_FORCE_INLINE static Slab* get_slab(void *memory)
+{
+    return (Slab *)((uintptr_t)memory & ~(uintptr_t)(HE_SLAB_SIZE - 1));
+}
+
+HE_FORCE_INLINE static bool is_slab_memory(Slab_Allocator *allocator, void *memory)
+{
+    return (U8 *)memory >= allocator->base && (U8 *)memory < allocator->base + allocator->capacity;
+}
+
+HE_FORCE_INLINE static U32 get_slot_index(Slab *slab, void *memory)
+{
+    return (U32)(((U8 *)memory - ((U8 *)slab + HE_SLAB_FIRST_SLOT_OFFSET)) / slab->slot_size);
+}
+
+static Slab* acquire_slab(Slab_Allocator *allocator)
+{
+    platform_lock_mutex(&allocator->slab_mutex);
+
+    Slab *slab = allocator->free_slabs;
+    if (slab)
+    {
+        allocator->free_slabs = slab->next_slab;
+    }
+    else if ((allocator->slab_count + 1) * HE_SLAB_SIZE <= allocator->capacity)
+    {
+        U8 *memory = allocator->base + allocator->slab_count * HE_SLAB_SIZE;
+        if (platform_commit_memory(memory, HE_SLAB_SIZE))
+        {
+            slab = (Slab *)memory;
+            allocator->slab_count++;
+        }
+    }
+
+    platform_unlock_mutex(&allocator->slab_mutex);
+    return slab;
+}
+
+static void release_slab(Slab_Allocator *allocator, Slab *slab)
+{
+    platform_lock_mutex(&allocator->slab_mutex);
+    slab->next_slab = allocator->free_slabs;
+    allocator->free_slabs = slab;
+    platform_unlock_mutex(&allocator->slab_mutex);
+}
+
+static void init_slab(Slab *slab, U32 size_class)
+{
+    slab->next_slab = nullptr;
+    slab->prev_slab = nullptr;
+    slab->size_class = size_class;
+    slab->slot_size = (size_class + 1) * HE_SLAB_SIZE_CLASS_GRANULARITY;
+    slab->slot_count = (U32)((HE_SLAB_SIZE - HE_SLAB_FIRST_SLOT_OFFSET) / slab->slot_size);
+    slab->used_slot_count = 0;
+    slab->first_free_word_index = 0;
+
+    // bits past the last slot are set so the bitmap search never returns them.
+    zero_memory(slab->used_slot_bitmap, sizeof(slab->used_slot_bitmap));
+    for (U32 word_index = slab->slot_count / 64; word_index < HE_SLAB_BITMAP_WORD_COUNT; word_index++)
+    {
+        U32 first_unused_bit = word_index == slab->slot_count / 64 ? slab->slot_count % 64 : 0;
+        slab->used_slot_bitmap[word_index] = ~0ull << first_unused_bit;
+    }
+}
+
+static void push_partial_slab(Slab_Size_Class *size_class_state, Slab *slab)
+{
+    slab->prev_slab = nullptr;
+    slab->next_slab = size_class_state->partial_slabs;
+    if (slab->next_slab)
+    {
+        slab->next_slab->prev_slab = slab;
+    }
+    size_class_state->partial_slabs = slab;
+}
+
+static void remove_partial_slab(Slab_Size_Class *size_class_state, Slab *slab)
+{
+    if (slab->prev_slab)
+    {
+        slab->prev_slab->next_slab = slab->next_slab;
+    }
+    else
+    {
+        size_class_state->partial_slabs = slab->next_slab;
+    }
+
+    if (slab->next_slab)
+    {
+        slab->next_slab->prev_slab = slab->prev_slab;
+    }
+
+    slab->next_slab = nullptr;
+    slab->prev_slab = nullptr;
+}
+
+// the size class mutex has to be held, returns how many slots were taken which is less than count only when out of slabs.
+static U32 take_slots(Slab_Allocator *allocator, U32 size_class, void **slots, U32 count)
+{
+    Slab_Size_Class *size_class_state = &allocator->size_classes[size_class];
+    U32 taken_count = 0;
+
+    while (taken_count < count)
+    {
+        Slab *slab = size_class_state->partial_slabs;
+        if (!slab)
+        {
+            slab = acquire_slab(allocator);
+            if (!slab)
+            {
+                break;
+            }
+
+            init_slab(slab, size_class);
+            push_partial_slab(size_class_state, slab);
+        }
+
+        while (taken_count < count && slab->used_slot_count < slab->slot_count)
+        {
+            U32 word_index = slab->first_free_word_index;
+            while (slab->used_slot_bitmap[word_index] == ~0ull)
+            {
+                word_index++;
+            }
+
+            U32 bit_index = (U32)_tzcnt_u64(~slab->used_slot_bitmap[word_index]);
+            slab->used_slot_bitmap[word_index] |= 1ull << bit_index;
+            slab->first_free_word_index = word_index;
+            slab->used_slot_count++;
+
+            U32 slot_index = word_index * 64 + bit_index;
+            slots[taken_count++] = (U8 *)slab + HE_SLAB_FIRST_SLOT_OFFSET + (U64)slot_index * slab->slot_size;
+            record_allocation(&size_class_state->stats, slab->slot_size);
+        }
+
+        if (slab->used_slot_count == slab->slot_count)
+        {
+            remove_partial_slab(size_class_state, slab);
+        }
+    }
+
+    return taken_count;
+}
+
+// the size class mutex has to be held.
+static void return_slots(Slab_Allocator *allocator, U32 size_class, void **slots, U32 count)
+{
+    Slab_Size_Class *size_class_state = &allocator->size_classes[size_class];
+
+    for (U32 index = 0; index < count; index++)
+    {
+        Slab *slab = get_slab(slots[index]);
+        HE_ASSERT(slab->size_class == size_class);
+
+        U32 slot_index = get_slot_index(slab, slots[index]);
+        U32 word_index = slot_index / 64;
+        U64 slot_bit = 1ull << (slot_index % 64);
+        HE_ASSERT(slab->used_slot_bitmap[word_index] & slot_bit);
+
+        slab->used_slot_bitmap[word_index] &= ~slot_bit;
+        slab->first_free_word_index = HE_MIN(slab->first_free_word_index, word_index);
+
+        if (slab->used_slot_count == slab->slot_count)
+        {
+            push_partial_slab(size_class_state, slab);
+        }
+
+        slab->used_slot_count--;
+        record_deallocation(&size_class_state->stats, slab->slot_size);
+
+        // one empty slab stays with the size class so alternating allocations and frees don't bounce slabs.
+        if (!slab->used_slot_count && (size_class_state->partial_slabs != slab || slab->next_slab))
+        {
+            remove_partial_slab(size_class_state, slab);
+            release_slab(allocator, slab);
+        }
+    }
+}
+
+static Slab_Thread_Cache* get_slab_thread_cache(Slab_Allocator *allocator)
+{
+    if (!(allocator->flags & SlabAllocatorFlag_ThreadCaches) || !current_thread_context)
+    {
+        return nullptr;
+    }
+
+    Slab_Thread_Cache *&thread_cache = allocator->thread_caches[current_thread_context->thread_index];
+    if (!thread_cache)
+    {
+        // a thread cache takes a whole slab and keeps it.
+        thread_cache = (Slab_Thread_Cache *)acquire_slab(allocator);
+        if (thread_cache)
+        {
+            zero_memory(thread_cache, sizeof(Slab_Thread_Cache));
+        }
+    }
+
+    return thread_cache;
+}
+
+static void* allocate_fallback(Slab_Allocator *allocator, U64 size, U16 alignment, bool zero)
+{
+    Allocator fallback_allocator = allocator->fallback_allocator;
+    if (!zero && fallback_allocator.allocate_uninitialized)
+    {
+        return fallback_allocator.allocate_uninitialized(fallback_allocator.data, size, alignment);
+    }
+    return fallback_allocator.allocate(fallback_allocator.data, size, alignment);
+}
+
+static void* allocate_slot(Slab_Allocator *allocator, U64 size, U16 alignment, bool zero)
+{
+    HE_ASSERT(allocator);
+
+    if (size > HE_SLAB_MAX_SLOT_SIZE || alignment > HE_SLAB_SIZE_CLASS_GRANULARITY)
+    {
+        return allocate_fallback(allocator, size, alignment, zero);
+    }
+
+    U32 size_class = get_slab_size_class(size);
+    Slab_Size_Class *size_class_state = &allocator->size_classes[size_class];
+    void *memory = nullptr;
+
+    Slab_Thread_Cache *thread_cache = get_slab_thread_cache(allocator);
+    if (thread_cache)
+    {
+        Slab_Thread_Cache_Bin *bin = &thread_cache->bins[size_class];
+        if (!bin->count)
+        {
+            platform_lock_mutex(&size_class_state->mutex);
+            bin->count = take_slots(allocator, size_class, bin->slots, HE_SLAB_THREAD_CACHE_CAPACITY / 2);
+            platform_unlock_mutex(&size_class_state->mutex);
+        }
+
+        if (bin->count)
+        {
+            memory = bin->slots[--bin->count];
+        }
+    }
+    else
+    {
+        platform_lock_mutex(&size_class_state->mutex);
+        take_slots(allocator, size_class, &memory, 1);
+        platform_unlock_mutex(&size_class_state->mutex);
+    }
+
+    if (!memory)
+    {
+        return allocate_fallback(allocator, size, alignment, zero);
+    }
+
+    Slab *slab = get_slab(memory);
+    slab->slot_tags[get_slot_index(slab, memory)] = thread_memory_tag;
+    record_tag_allocation(thread_memory_tag, slab->slot_size);
+
+    if (zero)
+    {
+        zero_memory(memory, slab->slot_size);
+    }
+
+    return memory;
+}
+
+void* allocate(Slab_Allocator *allocator, U64 size, U16 alignment)
+{
+    return allocate_slot(allocator, size, alignment, true);
+}
+
+void* allocate_uninitialized(Slab_Allocator *allocator, U64 size, U16 alignment)
+{
+    return allocate_slot(allocator, size, alignment, false);
+}
+
+void* reallocate(Slab_Allocator *allocator, void *memory, U64 old_size, U64 new_size, U16 alignment)
+{
+    HE_ASSERT(allocator);
+
+    if (!memory)
+    {
+        return allocate_slot(allocator, new_size, alignment, true);
+    }
+
+    // fallback allocations stay with the fallback allocator.
+    if (!is_slab_memory(allocator, memory))
+    {
+        Allocator fallback_allocator = allocator->fallback_allocator;
+        return fallback_allocator.reallocate(fallback_allocator.data, memory, old_size, new_size, alignment);
+    }
+
+    Slab *slab = get_slab(memory);
+    if (new_size <= slab->slot_size && alignment <= HE_SLAB_SIZE_CLASS_GRANULARITY)
+    {
+        return memory;
+    }
+
+    void *new_memory = allocate_slot(allocator, new_size, alignment, true);
+    copy_memory(new_memory, memory, HE_MIN((U64)slab->slot_size, new_size));
+    deallocate(allocator, memory);
+    return new_memory;
+}
+
+void deallocate(Slab_Allocator *allocator, void *memory)
+{
+    HE_ASSERT(allocator);
+
+    if (!memory)
+    {
+        return;
+    }
+
+    if (!is_slab_memory(allocator, memory))
+    {
+        Allocator fallback_allocator = allocator->fallback_allocator;
+        fallback_allocator.deallocate(fallback_allocator.data, memory);
+        return;
+    }
+
+    Slab *slab = get_slab(memory);
+    record_tag_deallocation(slab->slot_tags[get_slot_index(slab, memory)], slab->slot_size);
+
+    U32 size_class = slab->size_class;
+    Slab_Size_Class *size_class_state = &allocator->size_classes[size_class];
+
+    Slab_Thread_Cache *thread_cache = get_slab_thread_cache(allocator);
+    if (thread_cache)
+    {
+        Slab_Thread_Cache_Bin *bin = &thread_cache->bins[size_class];
+        if (bin->count == HE_SLAB_THREAD_CACHE_CAPACITY)
+        {
+            // give back the older half, the recently freed slots are more likely to be in the cache.
+            constexpr U32 drain_count = HE_SLAB_THREAD_CACHE_CAPACITY / 2;
+
+            platform_lock_mutex(&size_class_state->mutex);
+            return_slots(allocator, size_class, bin->slots, drain_count);
+            platform_unlock_mutex(&size_class_state->mutex);
+
+            copy_memory(bin->slots, bin->slots + drain_count, sizeof(void *) * (bin->count - drain_count));
+            bin->count -= drain_count;
+        }
+
+        bin->slots[bin->count++] = memory;
+        return;
+    }
+
+    platform_lock_mutex(&size_class_state->mutex);
+    return_slots(allocator, size_class, &memory, 1);
+    platform_unlock_mutex(&size_class_state->mutex);
+}
+
+void *slab_allocator_allocate(void *slab_allocator, U64 size, U16 alignment)
+{
+    return allocate((Slab_Allocator *)slab_allocator, size, alignment);
+}
+
+void *slab_allocator_reallocate(void *slab_allocator, void *memory, U64 old_size, U64 new_size, U16 alignment)
+{
+    return reallocate((Slab_Allocator *)slab_allocator, memory, old_size, new_size, alignment);
+}
+
+void slab_allocator_deallocate(void *slab_allocator, void *memory)
+{
+    deallocate((Slab_Allocator *)slab_allocator, memory);
+}
+
+void *slab_allocator_allocate_uninitialized(void *slab_allocator, U64 size, U16 alignment)
+{
+    return allocate_uninitialized((Slab_Allocator *)slab_allocator, size, alignment);
+}
+
+//
+// Memory Snapshot
+//
+
+void update_memory_stats()
+{
+    for (U32 tag_index = 0; tag_index < (U32)Memory_Tag::COUNT; tag_index++)
+    {
+        Memory_Tag tag = (Memory_Tag)tag_index;
+        U64 soft_budget = memory_tag_budgets[tag_index].soft_budget.load(std::memory_order_relaxed);
+        if (soft_budget && get_memory_tag_live_bytes(tag) > soft_budget)
+        {
+            run_memory_pressure_callbacks(tag, soft_budget);
+        }
+    }
+
+#if HE_MEMORY_TRACKING
+    for (U32 tag_index = 0; tag_index < (U32)Memory_Tag::COUNT; tag_index++)
+    {
+        Memory_Tag_Counters *counters = &memory_tag_counters[tag_index];
+        U64 allocated_bytes = counters->allocated_bytes.load(std::memory_order_relaxed);
+        counters->frame_allocated_bytes = allocated_bytes - counters->frame_start_allocated_bytes;
+        counters->frame_start_allocated_bytes = allocated_bytes;
+    }
+#endif
+
+    update_frame_stats(&memory_system_state.permenent_arena.stats);
+    update_frame_stats(&memory_system_state.frame_arena.stats);
+    update_frame_stats(&memory_system_state.debug_arena.stats);
+
+    for (U32 frame_index = 0; frame_index < HE_FRAME_MEMORY_COUNT; frame_index++)
+    {
+        Frame_Memory *frame_memory = &memory_system_state.frame_memories[frame_index];
+        platform_lock_mutex(&frame_memory->mutex);
+        update_frame_stats(&frame_memory->arena.stats);
+        platform_unlock_mutex(&frame_memory->mutex);
+    }
+
+    U32 allocator_count = free_list_allocator_count.load(std::memory_order_relaxed);
+    for (U32 allocator_index = 0; allocator_index < allocator_count; allocator_index++)
+    {
+        Free_List_Allocator *allocator = free_list_allocators[allocator_index];
+        platform_lock_mutex(&allocator->mutex);
+        update_frame_stats(&allocator->stats);
+        platform_unlock_mutex(&allocator->mutex);
+    }
+
+    U32 slab_allocator_total = slab_allocator_count.load(std::memory_order_relaxed);
+    for (U32 allocator_index = 0; allocator_index < slab_allocator_total; allocator_index++)
+    {
+        Slab_Allocator *allocator = slab_allocators[allocator_index];
+        for (U32 size_class = 0; size_class < HE_SLAB_SIZE_CLASS_COUNT; size_class++)
+        {
+            Slab_Size_Class *size_class_state = &allocator->size_classes[size_class];
+            platform_lock_mutex(&size_class_state->mutex);
+            update_frame_stats(&size_class_state->stats);
+            platform_unlock_mutex(&size_class_state->mutex);
+        }
+    }
+
+    // the frame counters of the thread arenas are only written here, the rest of their stats are approximate.
+    for (U32 thread_index = 0; thread_index < get_thread_context_count(); thread_index++)
+    {
+        update_frame_stats(&memory_system_state.thread_contexts[thread_index].arena.stats);
+    }
+}
+
+static void append_arena_snapshot(Memory_Snapshot *snapshot, const char *name, Memory_Arena *arena)
+{
+    if (snapshot->allocator_count == HE_MAX_MEMORY_SNAPSHOT_ALLOCATOR_COUNT)
+    {
+        return;
+    }
+
+    snapshot->allocators[snapshot->allocator_count++] =
+    {
+        .name = name,
+        .capacity = arena->capacity,
+        .committed = arena->size,
+        .stats = arena->stats
+    };
+}
+
+void take_memory_snapshot(Memory_Snapshot *snapshot)
+{
+    HE_ASSERT(snapshot);
+    zero_memory(snapshot, sizeof(Memory_Snapshot));
+
+    for (U32 tag_index = 0; tag_index < (U32)Memory_Tag::COUNT; tag_index++)
+    {
+        snapshot->budgets[tag_index] = get_memory_budget((Memory_Tag)tag_index);
+    }
+
+    for (U32 tag_index = 0; tag_index < (U32)Memory_Tag::COUNT; tag_index++)
+    {
+        Memory_Tag_Counters *counters = &memory_tag_counters[tag_index];
+        Memory_Stats *stats = &snapshot->tags[tag_index];
+        stats->live_bytes = counters->live_bytes.load(std::memory_order_relaxed);
+
+#if HE_MEMORY_TRACKING
+        stats->allocation_count = counters->allocation_count.load(std::memory_order_relaxed);
+        stats->peak_bytes = counters->peak_bytes.load(std::memory_order_relaxed);
+        stats->allocated_bytes = counters->allocated_bytes.load(std::memory_order_relaxed);
+        stats->frame_allocated_bytes = counters->frame_allocated_bytes;
+        stats->frame_start_allocated_bytes = counters->frame_start_allocated_bytes;
+#endif
+    }
+
+    append_arena_snapshot(snapshot, "permenent_arena", &memory_system_state.permenent_arena);
+    append_arena_snapshot(snapshot, "frame_arena", &memory_system_state.frame_arena);
+    append_arena_snapshot(snapshot, "debug_arena", &memory_system_state.debug_arena);
+
+    for (U32 frame_index = 0; frame_index < HE_FRAME_MEMORY_COUNT; frame_index++)
+    {
+        Frame_Memory *frame_memory = &memory_system_state.frame_memories[frame_index];
+        platform_lock_mutex(&frame_memory->mutex);
+        append_arena_snapshot(snapshot, "frame_memory", &frame_memory->arena);
+        platform_unlock_mutex(&frame_memory->mutex);
+    }
+
+    U32 allocator_count = free_list_allocator_count.load(std::memory_order_relaxed);
+    for (U32 allocator_index = 0; allocator_index < allocator_count && snapshot->allocator_count < HE_MAX_MEMORY_SNAPSHOT_ALLOCATOR_COUNT; allocator_index++)
+    {
+        Free_List_Allocator *allocator = free_list_allocators[allocator_index];
+        platform_lock_mutex(&allocator->mutex);
+        snapshot->allocators[snapshot->allocator_count++] =
+        {
+            .name = allocator->debug_name,
+            .capacity = allocator->capacity,
+            .committed = allocator->size,
+            .stats = allocator->stats
+        };
+        platform_unlock_mutex(&allocator->mutex);
+    }
+
+    U32 slab_allocator_total = slab_allocator_count.load(std::memory_order_relaxed);
+    for (U32 allocator_index = 0; allocator_index < slab_allocator_total && snapshot->allocator_count < HE_MAX_MEMORY_SNAPSHOT_ALLOCATOR_COUNT; allocator_index++)
+    {
+        Slab_Allocator *allocator = slab_allocators[allocator_index];
+        Memory_Allocator_Snapshot *allocator_snapshot = &snapshot->allocators[snapshot->allocator_count++];
+        allocator_snapshot->name = allocator->debug_name;
+        allocator_snapshot->capacity = allocator->capacity;
+
+        platform_lock_mutex(&allocator->slab_mutex);
+        allocator_snapshot->committed = allocator->slab_count * HE_SLAB_SIZE;
+        platform_unlock_mutex(&allocator->slab_mutex);
+
+        // the peak is the sum of the size class peaks.
+        Memory_Stats *stats = &allocator_snapshot->stats;
+        for (U32 size_class = 0; size_class < HE_SLAB_SIZE_CLASS_COUNT; size_class++)
+        {
+            Slab_Size_Class *size_class_state = &allocator->size_classes[size_class];
+            platform_lock_mutex(&size_class_state->mutex);
+            stats->live_bytes += size_class_state->stats.live_bytes;
+            stats->allocation_count += size_class_state->stats.allocation_count;
+            stats->peak_bytes += size_class_state->stats.peak_bytes;
+            stats->allocated_bytes += size_class_state->stats.allocated_bytes;
+            stats->frame_allocated_bytes += size_class_state->stats.frame_allocated_bytes;
+            stats->frame_start_allocated_bytes += size_class_state->stats.frame_start_allocated_bytes;
+            platform_unlock_mutex(&size_class_state->mutex);
+        }
+    }
+
+    for (U32 thread_index = 0; thread_index < get_thread_context_count(); thread_index++)
+    {
+        append_arena_snapshot(snapshot, "thread_arena", &memory_system_state.thread_contexts[thread_index].arena);
+    }
+}
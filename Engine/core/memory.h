@@ -10,6 +10,15 @@
 
 #define HE_DEFAULT_ALIGNMENT 16
 
+#define HE_MAX_THREAD_CONTEXT_COUNT 128
+
+#define HE_MEMORY_TRACKING 1
+
+#ifdef HE_SHIPPING
+#undef HE_MEMORY_TRACKING
+#define HE_MEMORY_TRACKING 0
+#endif
+
 #define HE_ALLOCATE(allocator_pointer, type) \
 (type *)allocate((allocator_pointer), sizeof(type), HE_DEFAULT_ALIGNMENT)
 
@@ -34,6 +43,14 @@
 #define HE_ALLOCATOR_ALLOCATE_ARRAY(allocator, type, count) \
 (type *)(allocator).allocate((allocator).data, sizeof(type) * (count), alignof(type))
 
+// for untyped blocks whose size and alignment are only known at runtime.
+#define HE_ALLOCATOR_ALLOCATE_SIZED(allocator, size, alignment) \
+(allocator).allocate((allocator).data, size, alignment)
+
+// for memory that is fully overwritten right away, falls back to allocate if the allocator always zeroes.
+#define HE_ALLOCATOR_ALLOCATE_ARRAY_UNINITIALIZED(allocator, type, count) \
+(type *)((allocator).allocate_uninitialized ? (allocator).allocate_uninitialized : (allocator).allocate)((allocator).data, sizeof(type) * (count), alignof(type))
+
 #define HE_ALLOCATOR_REALLOCATE_ARRAY(allocator, memory, type, count) \
 (type *)(allocator).reallocate((allocator).data, memory, 0, sizeof(type) * (count), alignof(type))
 
@@ -54,12 +71,99 @@ struct Allocator
     void* (*allocate)(void *data, U64 size, U16 alignment);
     void* (*reallocate)(void *data, void *memory, U64 old_size, U64 new_size, U16 alignment);
     void  (*deallocate)(void *data, void *memory);
+    void* (*allocate_uninitialized)(void *data, U64 size, U16 alignment);
 };
 
+//
+// Memory Tracking
+//
+
+enum class Memory_Tag : U8
+{
+    UNTAGGED,
+    ASSETS,
+    TEXTURES,
+    SHADERS,
+    MATERIALS,
+    MESHES,
+    SCENES,
+    RENDERER,
+    JOBS,
+    EDITOR,
+    LOGGING,
+    COUNT
+};
+
+struct Memory_Stats
+{
+    U64 live_bytes;
+    U64 allocation_count;
+    U64 peak_bytes;
+    U64 allocated_bytes; // since startup.
+    U64 frame_allocated_bytes; // during the last frame.
+    U64 frame_start_allocated_bytes;
+};
+
+const char* memory_tag_to_string(Memory_Tag tag);
+
+// allocations from the free list allocators without an explicit tag use the tag of the calling thread, returns the previous tag.
+Memory_Tag set_thread_memory_tag(Memory_Tag tag);
+Memory_Tag get_thread_memory_tag();
+
+// memory the allocators don't see like gpu resources, counts against the stats and the budget of the tag.
+void record_external_allocation(Memory_Tag tag, U64 size);
+void record_external_deallocation(Memory_Tag tag, U64 size);
+
+U64 get_memory_tag_live_bytes(Memory_Tag tag);
+
+//
+// Memory Budgets
+//
+
+#define HE_MAX_MEMORY_PRESSURE_CALLBACK_COUNT 8
+
+enum class Memory_Pressure : U8
+{
+    NONE,
+    SOFT, // over the soft budget, caches should shrink.
+    HARD  // over the hard budget, new work should wait or degrade.
+};
+
+// zero means no budget.
+struct Memory_Budget
+{
+    U64 soft_budget;
+    U64 hard_budget;
+};
+
+// should free memory of the tag until its live bytes drop to target_bytes, runs on the main thread once per frame
+// while the tag is over its soft budget and on the thread that called reclaim_memory.
+typedef void(*memory_pressure_proc)(Memory_Tag tag, U64 live_bytes, U64 target_bytes, void *user_data);
+
+void set_memory_budget(Memory_Tag tag, U64 soft_budget, U64 hard_budget);
+Memory_Budget get_memory_budget(Memory_Tag tag);
+Memory_Pressure get_memory_pressure(Memory_Tag tag);
+
+bool register_memory_pressure_callback(Memory_Tag tag, memory_pressure_proc proc, void *user_data = nullptr);
+void unregister_memory_pressure_callback(Memory_Tag tag, memory_pressure_proc proc, void *user_data = nullptr);
+
+// runs the pressure callbacks of the tag until size more bytes fit in its hard budget, returns false if they still don't.
+// callbacks can take locks so it shouldn't be called while holding one of them.
+bool reclaim_memory(Memory_Tag tag, U64 size);
+
 //
 // Memory Arena
 //
 
+enum Memory_Arena_Flags
+{
+    MemoryArenaFlag_None = 0 << 0,
+    MemoryArenaFlag_LargePages = 1 << 0, // backs the initial commit with large pages if the platform allows it.
+};
+
+// arenas with a decommit threshold are trimmed once every this many times they are emptied.
+#define HE_MEMORY_ARENA_TRIM_PERIOD 64
+
 struct Memory_Arena
 {
     U8 *base;
@@ -68,21 +172,35 @@ struct Memory_Arena
     U64 size;
     U64 offset;
     S64 temp_count;
+
+    U64 peak_offset;
+    U64 decommit_threshold; // commited memory further than this above the recent peak offset is decommited, zero disables it.
+
+    U64 trim_peak_offset; // the highest peak offset since the last trim.
+    U32 release_count; // times the arena was emptied since the last trim.
+
+    Memory_Stats stats; // arenas don't free individual allocations, the allocation count only grows.
 };
 
-bool init_memory_arena(Memory_Arena *memory_arena, U64 capacity, U64 min_allocation_size = HE_MEGA_BYTES(1));
+bool init_memory_arena(Memory_Arena *memory_arena, U64 capacity, U64 min_allocation_size = HE_MEGA_BYTES(1), Memory_Arena_Flags flags = MemoryArenaFlag_None);
+void deinit_memory_arena(Memory_Arena *memory_arena);
+
+// decommits the memory above the peak offset since the last trim.
+void trim_memory_arena(Memory_Arena *memory_arena);
 
 void* allocate(Memory_Arena *memory_arena, U64 size, U16 alignment);
+void* allocate_uninitialized(Memory_Arena *memory_arena, U64 size, U16 alignment);
 void* reallocate(Memory_Arena *memory_arena, void *memory, U64 old_size, U64 new_size, U16 alignment);
 void deallocate(Memory_Arena *memory_arena, void *memory);
 
 void *memory_arena_allocate(void *memory_arena, U64 size, U16 alignment);
 void *memory_arena_reallocate(void *memory_arena, void *memory, U64 old_size, U64 new_size, U16 alignment);
 void memory_arena_deallocate(void *memory_arena, void *memory);
+void *memory_arena_allocate_uninitialized(void *memory_arena, U64 size, U16 alignment);
 
 HE_FORCE_INLINE Allocator to_allocator(Memory_Arena *memory_arena)
 {
-    return { .data = memory_arena, .allocate = &memory_arena_allocate, .reallocate = &memory_arena_reallocate, .deallocate = &memory_arena_deallocate };
+    return { .data = memory_arena, .allocate = &memory_arena_allocate, .reallocate = &memory_arena_reallocate, .deallocate = &memory_arena_deallocate, .allocate_uninitialized = &memory_arena_allocate_uninitialized };
 }
 
 //
@@ -102,10 +220,30 @@ void end_temprary_memory(Temprary_Memory temprary_memory);
 // Free List Allocator
 //
 
-struct Free_List_Node
+// two-level segregated fit: the first level splits block sizes by powers of two and the second level
+// splits each power of two range linearly, both levels have a bitmap of the non-empty free lists.
+#define HE_FREE_LIST_ALIGNMENT_LOG2 4
+#define HE_FREE_LIST_SECOND_LEVEL_COUNT_LOG2 5
+#define HE_FREE_LIST_SECOND_LEVEL_COUNT (1 << HE_FREE_LIST_SECOND_LEVEL_COUNT_LOG2)
+#define HE_FREE_LIST_FIRST_LEVEL_SHIFT (HE_FREE_LIST_SECOND_LEVEL_COUNT_LOG2 + HE_FREE_LIST_ALIGNMENT_LOG2)
+#define HE_FREE_LIST_FIRST_LEVEL_MAX 39
+#define HE_FREE_LIST_FIRST_LEVEL_COUNT (HE_FREE_LIST_FIRST_LEVEL_MAX - HE_FREE_LIST_FIRST_LEVEL_SHIFT + 2)
+#define HE_FREE_LIST_MAX_THREAD_CACHE_COUNT 128
+
+struct Free_List_Block
 {
-    U64 size;
-    Free_List_Node *next;
+    Free_List_Block *prev_physical_block;
+    U64 size; // includes the header, the lowest bit is set when the block is free and the top 16 bits tag blocks owned by a thread cache.
+
+    // only valid when the block is free.
+    Free_List_Block *next_free_block;
+    Free_List_Block *prev_free_block;
+};
+
+struct Free_List_Tagged_Allocator
+{
+    struct Free_List_Allocator *allocator;
+    Memory_Tag tag;
 };
 
 struct Free_List_Allocator
@@ -114,36 +252,149 @@ struct Free_List_Allocator
     U8 *base;
     U64 capacity;
     U64 size;
-    U64 used;
     U64 min_allocation_size;
-    Free_List_Node *head;
+
+    Memory_Stats stats; // blocks held by thread caches count as live.
+
+    U64 first_level_bitmap;
+    U32 second_level_bitmaps[HE_FREE_LIST_FIRST_LEVEL_COUNT];
+    Free_List_Block *free_blocks[HE_FREE_LIST_FIRST_LEVEL_COUNT][HE_FREE_LIST_SECOND_LEVEL_COUNT];
+    Free_List_Block *sentinel_block; // zero sized allocated block marking the end of the commited memory.
+
+    // small and medium blocks are served from per thread caches without taking the mutex when use_thread_caches is set,
+    // each cache can hold on to a few tens of kilobytes so allocators with few or large allocations leave it off.
+    bool use_thread_caches;
+    struct Free_List_Thread_Cache *thread_caches[HE_FREE_LIST_MAX_THREAD_CACHE_COUNT];
+
+    Free_List_Tagged_Allocator tagged_allocators[(U32)Memory_Tag::COUNT];
+
     Mutex mutex;
 };
 
-bool init_free_list_allocator(Free_List_Allocator *allocator, void *memory, U64 capacity, U64 size, const char *name);
+bool init_free_list_allocator(Free_List_Allocator *allocator, void *memory, U64 capacity, U64 size, const char *name, bool use_thread_caches = false);
 
 void* allocate(Free_List_Allocator *allocator, U64 size, U16 alignment);
+void* allocate(Free_List_Allocator *allocator, U64 size, U16 alignment, Memory_Tag tag);
+void* allocate_uninitialized(Free_List_Allocator *allocator, U64 size, U16 alignment);
 void* reallocate(Free_List_Allocator *allocator, void *memory, U64 old_size, U64 new_size, U16 alignment);
 void deallocate(Free_List_Allocator *allocator, void *memory);
 
 void *free_list_allocator_allocate(void *free_list_allocator, U64 size, U16 alignment);
 void *free_list_allocator_reallocate(void *free_list_allocator, void *memory, U64 old_size, U64 new_size, U16 alignment);
 void free_list_allocator_deallocate(void *free_list_allocator, void *memory);
+void *free_list_allocator_allocate_uninitialized(void *free_list_allocator, U64 size, U16 alignment);
 
 HE_FORCE_INLINE Allocator to_allocator(Free_List_Allocator *allocator)
 {
-    return { .data = allocator, .allocate = &free_list_allocator_allocate, .reallocate = &free_list_allocator_reallocate, .deallocate = &free_list_allocator_deallocate };
+    return { .data = allocator, .allocate = &free_list_allocator_allocate, .reallocate = &free_list_allocator_reallocate, .deallocate = &free_list_allocator_deallocate, .allocate_uninitialized = &free_list_allocator_allocate_uninitialized };
+}
+
+void *free_list_tagged_allocator_allocate(void *tagged_allocator, U64 size, U16 alignment);
+void *free_list_tagged_allocator_reallocate(void *tagged_allocator, void *memory, U64 old_size, U64 new_size, U16 alignment);
+void free_list_tagged_allocator_deallocate(void *tagged_allocator, void *memory);
+void *free_list_tagged_allocator_allocate_uninitialized(void *tagged_allocator, U64 size, U16 alignment);
+
+// allocations through the returned allocator are tracked under tag whatever the tag of the calling thread is.
+HE_FORCE_INLINE Allocator to_allocator(Free_List_Allocator *allocator, Memory_Tag tag)
+{
+    return { .data = &allocator->tagged_allocators[(U32)tag], .allocate = &free_list_tagged_allocator_allocate, .reallocate = &free_list_tagged_allocator_reallocate, .deallocate = &free_list_tagged_allocator_deallocate, .allocate_uninitialized = &free_list_tagged_allocator_allocate_uninitialized };
+}
+
+//
+// Slab Allocator
+//
+
+// every size class carves equally sized slots out of its own slabs and tracks them with a bitmap, slabs are aligned
+// to their size so the slab of a slot is found by masking its address. bigger or over aligned allocations go to the fallback allocator.
+#define HE_SLAB_SIZE HE_KILO_BYTES(64)
+#define HE_SLAB_SIZE_CLASS_GRANULARITY 16
+#define HE_SLAB_SIZE_CLASS_COUNT 64
+#define HE_SLAB_MAX_SLOT_SIZE (HE_SLAB_SIZE_CLASS_GRANULARITY * HE_SLAB_SIZE_CLASS_COUNT)
+#define HE_SLAB_BITMAP_WORD_COUNT (HE_SLAB_SIZE / HE_SLAB_SIZE_CLASS_GRANULARITY / 64)
+
+struct Slab
+{
+    Slab *next_slab;
+    Slab *prev_slab;
+
+    U32 size_class;
+    U32 slot_size;
+    U32 slot_count;
+    U32 used_slot_count;
+    U32 first_free_word_index; // no free slot before this word.
+    U32 padding;
+
+    U64 used_slot_bitmap[HE_SLAB_BITMAP_WORD_COUNT];
+    Memory_Tag slot_tags[HE_SLAB_SIZE / HE_SLAB_SIZE_CLASS_GRANULARITY]; // tag of every slot handed out.
+};
+
+struct Slab_Size_Class
+{
+    Mutex mutex;
+    Slab *partial_slabs; // slabs with at least one free slot.
+    Memory_Stats stats; // slots held by thread caches count as live.
+};
+
+enum Slab_Allocator_Flags
+{
+    SlabAllocatorFlag_None = 0 << 0,
+    SlabAllocatorFlag_ThreadCaches = 1 << 0, // registered threads keep a few free slots of every size class to skip the size class mutex.
+};
+
+struct Slab_Allocator
+{
+    const char *debug_name;
+    U8 *base;
+    U64 capacity;
+    U32 flags;
+
+    Allocator fallback_allocator;
+
+    Mutex slab_mutex;
+    U64 slab_count; // slabs handed out so far, slabs are commited on first use.
+    Slab *free_slabs;
+
+    Slab_Size_Class size_classes[HE_SLAB_SIZE_CLASS_COUNT];
+
+    // indexed by Thread_Context::thread_index, only touched by the owning thread.
+    struct Slab_Thread_Cache *thread_caches[HE_MAX_THREAD_CONTEXT_COUNT];
+};
+
+bool init_slab_allocator(Slab_Allocator *allocator, U64 capacity, Allocator fallback_allocator, U32 flags, const char *debug_name);
+
+void* allocate(Slab_Allocator *allocator, U64 size, U16 alignment);
+void* allocate_uninitialized(Slab_Allocator *allocator, U64 size, U16 alignment);
+void* reallocate(Slab_Allocator *allocator, void *memory, U64 old_size, U64 new_size, U16 alignment);
+void deallocate(Slab_Allocator *allocator, void *memory);
+
+void *slab_allocator_allocate(void *slab_allocator, U64 size, U16 alignment);
+void *slab_allocator_reallocate(void *slab_allocator, void *memory, U64 old_size, U64 new_size, U16 alignment);
+void slab_allocator_deallocate(void *slab_allocator, void *memory);
+void *slab_allocator_allocate_uninitialized(void *slab_allocator, U64 size, U16 alignment);
+
+HE_FORCE_INLINE Allocator to_allocator(Slab_Allocator *allocator)
+{
+    return { .data = allocator, .allocate = &slab_allocator_allocate, .reallocate = &slab_allocator_reallocate, .deallocate = &slab_allocator_deallocate, .allocate_uninitialized = &slab_allocator_allocate_uninitialized };
 }
 
 bool init_memory_system();
 void deinit_memory_system();
 
-struct Thread_Memory_State
+// the memory system starts before the cvars are loaded, called once they are.
+void declare_memory_cvars();
+
+// registered once by every thread that uses the engine, per thread state elsewhere is indexed by thread_index instead of hashing the os thread id.
+struct Thread_Context
 {
+    U32 thread_index; // dense, the main thread is zero.
     Memory_Arena arena;
 };
 
-Thread_Memory_State *get_thread_memory_state(U32 thread_id);
+Thread_Context *register_thread_context();
+Thread_Context *get_thread_context();
+Thread_Context *get_thread_context(U32 thread_index);
+U32 get_thread_context_count();
+
 Memory_Arena *get_thread_arena();
 Memory_Arena *get_frame_arena();
 
@@ -152,6 +403,7 @@ struct Memory_Context
     Allocator permenent_allocator;
     Allocator general_allocator;
     Allocator frame_allocator;
+    Allocator slab_allocator; // small objects that are created and destroyed often, falls back to the general allocator.
     
     Temprary_Memory temprary_memory;
     Allocator temp_allocator;
@@ -162,4 +414,47 @@ struct Memory_Context
 };
 
 Memory_Context grab_memory_context();
-bool drop_memory_context(Memory_Context *memory_context, Allocator allocator);
\ No newline at end of file
+bool drop_memory_context(Memory_Context *memory_context, Allocator allocator);
+
+//
+// Frame Memory
+//
+
+#define HE_MAX_FRAME_MEMORY_FRAMES_AHEAD 2
+
+// a ring of arenas for data the gpu or deferred jobs read after the frame that wrote it, memory stays valid
+// until the gpu retired the frame frames_ahead frames after the current one. the allocator is thread safe.
+// threads that aren't synchronized with begin_frame_memory should grab at least one frame ahead, the current
+// frame can be retired while they grab it when only one frame is in flight.
+Allocator grab_frame_memory(U32 frames_ahead = 0);
+
+// starts the next frame, called right after waiting on the fence that retires the frame frames_in_flight frames back.
+void begin_frame_memory(U32 frames_in_flight);
+
+//
+// Memory Snapshot
+//
+
+#define HE_MAX_MEMORY_SNAPSHOT_ALLOCATOR_COUNT 64
+
+struct Memory_Allocator_Snapshot
+{
+    const char *name;
+    U64 capacity;
+    U64 committed;
+    Memory_Stats stats;
+};
+
+struct Memory_Snapshot
+{
+    Memory_Stats tags[(U32)Memory_Tag::COUNT];
+    Memory_Budget budgets[(U32)Memory_Tag::COUNT];
+
+    U32 allocator_count;
+    Memory_Allocator_Snapshot allocators[HE_MAX_MEMORY_SNAPSHOT_ALLOCATOR_COUNT];
+};
+
+// rolls the per frame allocation counters and runs the pressure callbacks of the tags over their soft budget, called once per frame.
+void update_memory_stats();
+
+void take_memory_snapshot(Memory_Snapshot *snapshot);
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "name.h"
+#include "platform.h"
+#include "memory.h"
+
+#include "containers/hash_map.h"
+#include "containers/virtual_array.h"
+
+struct Name_Entry
+{
+    String str;
+    U64 hash;
+};
+
+// finds a string key with a hash that was already computed.
+struct Name_Lookup
+{
+    String str;
+    U64 hash;
+};
+
+static HE_FORCE_INLINE U64 hash_key(const Name_Lookup &lookup)
+{
+    return lookup.hash;
+}
+
+static HE_FORCE_INLINE bool operator==(const String &lhs, const Name_Lookup &rhs)
+{
+    return lhs == rhs.str;
+}
+
+struct Name_Table
+{
+    Mutex mutex;
+
+    // entries never move so name_to_string can read them without taking the mutex.
+    Virtual_Array< Name_Entry > entries;
+    Hash_Map< String, U32 > string_to_id;
+
+    Memory_Arena string_arena;
+};
+
+static Name_Table name_table;
+
+bool init_names()
+{
+    if (!platform_create_mutex(&name_table.mutex))
+    {
+        return false;
+    }
+
+    if (!init(&name_table.entries, HE_MAX_NAME_COUNT))
+    {
+        return false;
+    }
+
+    if (!init_memory_arena(&name_table.string_arena, HE_MEGA_BYTES(64), HE_KILO_BYTES(64)))
+    {
+        return false;
+    }
+
+    init(&name_table.string_to_id, 1024);
+
+    String empty = HE_STRING_LITERAL("");
+    append(&name_table.entries, { .str = empty, .hash = hash_key(empty) });
+    return true;
+}
+
+void deinit_names()
+{
+    deinit(&name_table.string_to_id);
+    deinit(&name_table.entries);
+    deinit_memory_arena(&name_table.string_arena);
+    platform_destroy_mutex(&name_table.mutex);
+}
+
+Name make_name(String str)
+{
+    return make_name(str, hash_key(str));
+}
+
+Name make_name(String str, U64 hash)
+{
+    HE_ASSERT(hash == hash_key(str));
+
+    if (!str.count)
+    {
+        return {};
+    }
+
+    Name_Lookup lookup = { .str = str, .hash = hash };
+    Name name = {};
+
+    platform_lock_mutex(&name_table.mutex);
+
+    auto it = find(&name_table.string_to_id, lookup);
+    if (is_valid(it))
+    {
+        name.id = *it.value;
+    }
+    else
+    {
+        HE_ASSERT(name_table.entries.count < HE_MAX_NAME_COUNT);
+
+        String copy = copy_string(str, to_allocator(&name_table.string_arena));
+        name.id = name_table.entries.count;
+        append(&name_table.entries, { .str = copy, .hash = hash });
+        insert(&name_table.string_to_id, copy, name.id);
+    }
+
+    platform_unlock_mutex(&name_table.mutex);
+    return name;
+}
+
+Name find_name(String str)
+{
+    if (!str.count)
+    {
+        return {};
+    }
+
+    Name_Lookup lookup = { .str = str, .hash = hash_key(str) };
+    Name name = {};
+
+    platform_lock_mutex(&name_table.mutex);
+
+    auto it = find(&name_table.string_to_id, lookup);
+    if (is_valid(it))
+    {
+        name.id = *it.value;
+    }
+
+    platform_unlock_mutex(&name_table.mutex);
+    return name;
+}
+
+String name_to_string(Name name)
+{
+    HE_ASSERT(name.id < HE_MAX_NAME_COUNT);
+    return name_table.entries.data[name.id].str;
+}
+
+U64 get_name_hash(Name name)
+{
+    HE_ASSERT(name.id < HE_MAX_NAME_COUNT);
+    return name_table.entries.data[name.id].hash;
+}
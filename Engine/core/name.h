@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/defines.h"
+#include "containers/string.h"
+
+#include <type_traits>
+
+#define HE_MAX_NAME_COUNT (1024 * 1024)
+
+// an interned string, two names are equal when their ids are equal. id zero is the empty name.
+struct Name
+{
+    U32 id;
+};
+
+HE_FORCE_INLINE bool operator==(Name lhs, Name rhs)
+{
+    return lhs.id == rhs.id;
+}
+
+HE_FORCE_INLINE bool operator!=(Name lhs, Name rhs)
+{
+    return lhs.id != rhs.id;
+}
+
+HE_FORCE_INLINE U64 hash_key(Name name)
+{
+    return name.id;
+}
+
+bool init_names();
+void deinit_names();
+
+// thread safe, the string is copied the first time it's interned.
+Name make_name(String str);
+
+// hash must be hash_key(str).
+Name make_name(String str, U64 hash);
+
+// returns the empty name if str was never interned, doesn't intern it.
+Name find_name(String str);
+
+// the string stays valid until deinit_names and is null terminated.
+String name_to_string(Name name);
+U64 get_name_hash(Name name);
+
+// interns a string literal once per call site with its hash computed at compile time.
+#define HE_NAME(string_literal) ([]() -> Name\
+{\
+    static const Name name = make_name(HE_STRING_LITERAL(string_literal), std::integral_constant< U64, comptime_string_hash(string_literal) >::value);\
+    return name;\
+}())
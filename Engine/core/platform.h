@@ -53,8 +53,16 @@ U64 platform_get_total_memory_size();
 void* platform_allocate_memory(U64 size);
 void* platform_reserve_memory(U64 size);
 bool platform_commit_memory(void *memory, U64 size);
+bool platform_decommit_memory(void *memory, U64 size);
 void platform_deallocate_memory(void *memory);
 
+// returns zero if large pages are not supported or the process can't lock pages in memory.
+U64 platform_get_large_page_size();
+
+// reserves size bytes where the first commit_size bytes are commited with large pages, commit_size must be a multiple of the large page size.
+// returns null if large pages are not available or the rest of the range couldn't be reserved.
+void* platform_reserve_memory_with_large_pages(U64 size, U64 commit_size);
+
 //
 // window
 //
@@ -145,6 +153,13 @@ bool platform_unload_dynamic_library(Dynamic_Library *dynamic_library);
 void* platform_create_vulkan_surface(struct Engine *engine,
                                      void *instance,
                                      const void *allocator_callbacks = nullptr);
+//
+// time
+//
+
+U64 platform_get_performance_counter();
+U64 platform_get_performance_frequency(); // counts per second.
+
 //
 // threading
 //
@@ -162,12 +177,37 @@ U32 platform_get_thread_count();
 U32 platform_get_current_thread_id();
 U32 platform_get_thread_id(Thread *thread);
 
+// pins the thread to the logical processors of the first processor group set in the mask.
+bool platform_set_thread_affinity(Thread *thread, U64 logical_processor_mask);
+
+#define HE_MAX_PROCESSOR_CORE_COUNT 64
+
+struct Processor_Core
+{
+    U64 logical_processor_mask; // more than one bit set with smt.
+    U32 cache_domain_index;     // cores sharing the same last level cache have the same index.
+    U8 efficiency_class;        // higher is faster on hybrid processors, zero everywhere else.
+};
+
+// only covers the first processor group (64 logical processors).
+struct Processor_Topology
+{
+    U32 logical_processor_count;
+    U32 cache_domain_count;
+
+    U32 core_count;
+    Processor_Core cores[HE_MAX_PROCESSOR_CORE_COUNT];
+};
+
+bool platform_get_processor_topology(Processor_Topology *topology);
+
 struct Mutex
 {
     void *platform_mutex_state;
 };
 
 bool platform_create_mutex(Mutex *mutex);
+void platform_destroy_mutex(Mutex *mutex);
 void platform_lock_mutex(Mutex *mutex);
 void platform_unlock_mutex(Mutex *mutex);
 void platform_wait_for_mutexes(Mutex *mutexes, U32 mutex_count);
@@ -181,6 +221,11 @@ bool platform_create_semaphore(Semaphore *semaphore, U32 init_count = 0);
 bool platform_signal_semaphore(Semaphore *semaphore, U32 increase_amount = 1);
 bool platform_wait_for_semaphore(Semaphore *semaphore);
 
+// blocks while the value at address equals the value at compare_address, size can be 1, 2, 4 or 8 bytes.
+// might return spuriously so the caller has to recheck its condition.
+void platform_wait_on_address(volatile void *address, void *compare_address, U32 size);
+void platform_wake_all_on_address(void *address);
+
 //
 // imgui
 //
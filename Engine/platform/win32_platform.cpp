@@ -471,12 +471,88 @@ bool platform_commit_memory(void *memory, U64 size)
     return result != nullptr;
 }
 
+bool platform_decommit_memory(void *memory, U64 size)
+{
+    HE_ASSERT(memory);
+    HE_ASSERT(size);
+    return VirtualFree(memory, size, MEM_DECOMMIT) != 0;
+}
+
 void platform_deallocate_memory(void *memory)
 {
     HE_ASSERT(memory);
     VirtualFree(memory, 0, MEM_RELEASE);
 }
 
+static bool win32_enable_lock_memory_privilege()
+{
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES|TOKEN_QUERY, &token))
+    {
+        return false;
+    }
+
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    bool enabled = false;
+    if (LookupPrivilegeValueA(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid))
+    {
+        // AdjustTokenPrivileges succeeds even if the privilege isn't held by the account.
+        enabled = AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+    }
+
+    CloseHandle(token);
+    return enabled;
+}
+
+U64 platform_get_large_page_size()
+{
+    static bool privilege_enabled = win32_enable_lock_memory_privilege();
+    if (!privilege_enabled)
+    {
+        return 0;
+    }
+
+    return GetLargePageMinimum();
+}
+
+void* platform_reserve_memory_with_large_pages(U64 size, U64 commit_size)
+{
+    HE_ASSERT(size >= commit_size);
+
+    U64 large_page_size = platform_get_large_page_size();
+    if (!large_page_size || !commit_size || commit_size % large_page_size != 0)
+    {
+        return nullptr;
+    }
+
+    // large pages have to be reserved and commited in one call, the rest of the range is reserved right after them.
+    U8 *memory = (U8 *)VirtualAlloc(nullptr, commit_size, MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (!memory)
+    {
+        return nullptr;
+    }
+
+    if (size > commit_size)
+    {
+        void *tail = VirtualAlloc(memory + commit_size, size - commit_size, MEM_RESERVE, PAGE_NOACCESS);
+        if (tail != memory + commit_size)
+        {
+            if (tail)
+            {
+                VirtualFree(tail, 0, MEM_RELEASE);
+            }
+
+            VirtualFree(memory, 0, MEM_RELEASE);
+            return nullptr;
+        }
+    }
+
+    return memory;
+}
+
 //
 // window
 //
@@ -1011,6 +1087,20 @@ bool platform_create_and_start_thread(Thread *thread, Thread_Proc thread_proc, v
     return true;
 }
 
+U64 platform_get_performance_counter()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (U64)counter.QuadPart;
+}
+
+U64 platform_get_performance_frequency()
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (U64)frequency.QuadPart;
+}
+
 U32 platform_get_thread_count()
 {
     SYSTEM_INFO system_info = {};
@@ -1028,6 +1118,80 @@ U32 platform_get_thread_id(Thread *thread)
     return GetThreadId((HANDLE)thread->platform_thread_state);
 }
 
+bool platform_set_thread_affinity(Thread *thread, U64 logical_processor_mask)
+{
+    HE_ASSERT(thread);
+    HE_ASSERT(logical_processor_mask);
+    return SetThreadAffinityMask((HANDLE)thread->platform_thread_state, (DWORD_PTR)logical_processor_mask) != 0;
+}
+
+bool platform_get_processor_topology(Processor_Topology *topology)
+{
+    HE_ASSERT(topology);
+    zero_memory(topology, sizeof(Processor_Topology));
+
+    DWORD size = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+    if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+    {
+        return false;
+    }
+
+    Memory_Context memory_context = grab_memory_context();
+    U8 *buffer = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, U8, size);
+
+    if (!GetLogicalProcessorInformationEx(RelationAll, (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)buffer, &size))
+    {
+        return false;
+    }
+
+    U64 cache_domain_masks[HE_MAX_PROCESSOR_CORE_COUNT] = {};
+
+    for (U8 *it = buffer; it < buffer + size;)
+    {
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)it;
+        it += info->Size;
+
+        if (info->Relationship == RelationProcessorCore)
+        {
+            const GROUP_AFFINITY &group_mask = info->Processor.GroupMask[0];
+            if (group_mask.Group != 0 || topology->core_count == HE_MAX_PROCESSOR_CORE_COUNT)
+            {
+                continue;
+            }
+
+            Processor_Core *core = &topology->cores[topology->core_count++];
+            core->logical_processor_mask = group_mask.Mask;
+            core->efficiency_class = info->Processor.EfficiencyClass;
+            topology->logical_processor_count += (U32)__popcnt64(group_mask.Mask);
+        }
+        else if (info->Relationship == RelationCache && info->Cache.Level == 3)
+        {
+            if (info->Cache.GroupMask.Group != 0 || topology->cache_domain_count == HE_MAX_PROCESSOR_CORE_COUNT)
+            {
+                continue;
+            }
+
+            cache_domain_masks[topology->cache_domain_count++] = info->Cache.GroupMask.Mask;
+        }
+    }
+
+    for (U32 core_index = 0; core_index < topology->core_count; core_index++)
+    {
+        Processor_Core *core = &topology->cores[core_index];
+        for (U32 domain_index = 0; domain_index < topology->cache_domain_count; domain_index++)
+        {
+            if (core->logical_processor_mask & cache_domain_masks[domain_index])
+            {
+                core->cache_domain_index = domain_index;
+                break;
+            }
+        }
+    }
+
+    return topology->core_count != 0;
+}
+
 bool platform_create_mutex(Mutex *mutex)
 {
     CRITICAL_SECTION *critical_section = (CRITICAL_SECTION *)VirtualAlloc(0, sizeof(CRITICAL_SECTION), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
@@ -1040,6 +1204,14 @@ bool platform_create_mutex(Mutex *mutex)
     return true;
 }
 
+void platform_destroy_mutex(Mutex *mutex)
+{
+    CRITICAL_SECTION *critical_section = (CRITICAL_SECTION *)mutex->platform_mutex_state;
+    DeleteCriticalSection(critical_section);
+    VirtualFree(critical_section, 0, MEM_RELEASE);
+    mutex->platform_mutex_state = nullptr;
+}
+
 void platform_lock_mutex(Mutex *mutex)
 {
     CRITICAL_SECTION *critical_section = (CRITICAL_SECTION *)mutex->platform_mutex_state;
@@ -1082,6 +1254,20 @@ bool platform_wait_for_semaphore(Semaphore *semaphore)
     return result == WAIT_OBJECT_0;
 }
 
+void platform_wait_on_address(volatile void *address, void *compare_address, U32 size)
+{
+    HE_ASSERT(address);
+    HE_ASSERT(compare_address);
+    HE_ASSERT(size == 1 || size == 2 || size == 4 || size == 8);
+    WaitOnAddress(address, compare_address, size, INFINITE);
+}
+
+void platform_wake_all_on_address(void *address)
+{
+    HE_ASSERT(address);
+    WakeByAddressAll(address);
+}
+
 //
 // imgui
 //
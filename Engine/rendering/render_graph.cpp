@@ -14,9 +14,18 @@ void init(Render_Graph *render_graph)
     reset(&render_graph->resources);
     init(&render_graph->resource_cache, HE_MAX_RENDER_GRAPH_RESOURCE_COUNT, memory_context.general_allocator);
 
+    init(&render_graph->record_commands_task_graph, memory_context.general_allocator);
+
     render_graph->presentable_resource = nullptr; 
 }
 
+void deinit(Render_Graph *render_graph)
+{
+    deinit(&render_graph->record_commands_task_graph);
+    deinit(&render_graph->resource_cache);
+    deinit(&render_graph->node_cache);
+}
+
 static Render_Graph_Node& internal_add_node(Render_Graph *render_graph, const char *node_name, Execute_Render_Graph_Node_Proc execute, Render_Graph_Node_Type type)
 {
     HE_ASSERT(!is_valid(find(&render_graph->node_cache, HE_STRING(node_name))));
@@ -323,6 +332,8 @@ Render_Pass_Handle get_render_pass(Render_Graph *render_graph, String name)
     return node.render_pass;
 }
 
+static void build_record_commands_task_graph(Render_Graph *render_graph);
+
 bool compile(Render_Graph *render_graph, Renderer *renderer, Renderer_State *renderer_state)
 {
     for (Render_Graph_Node &node : render_graph->nodes)
@@ -438,6 +449,8 @@ bool compile(Render_Graph *render_graph, Renderer *renderer, Renderer_State *ren
         sorted_nodes[corresponding_node_index] = temp; 
     }
 
+    build_record_commands_task_graph(render_graph);
+
     return true;
 }
 
@@ -568,49 +581,67 @@ Job_Result record_render_graph_node_commands_job(const Job_Parameters &params)
     return Job_Result::SUCCEEDED;
 }
 
-void render(Render_Graph *render_graph, Renderer *renderer, Renderer_State *renderer_state)
+static void build_record_commands_task_graph(Render_Graph *render_graph)
 {
-    U32 frame_index = renderer_state->current_frame_in_flight_index;
-
-    auto &sorted_nodes = render_graph->topologically_sorted_nodes;
+    Task_Graph *task_graph = &render_graph->record_commands_task_graph;
+    reset(task_graph);
 
-    for (Render_Graph_Node_Handle node_handle : sorted_nodes)
+    for (Render_Graph_Node_Handle node_handle : render_graph->topologically_sorted_nodes)
     {
-        Render_Graph_Node &node = render_graph->nodes[node_handle];
-
         Record_Commands_Job_Data record_commands_job_data =
         {
             .render_graph = render_graph,
             .node_handle = node_handle,
         };
 
-        Job_Parameters job_parameters =
+        Job_Data job_data =
         {
-            .data = &record_commands_job_data,
-            .size = sizeof(Record_Commands_Job_Data),
-            .alignment = alignof(Record_Commands_Job_Data)
+            .parameters =
+            {
+                .data = &record_commands_job_data,
+                .size = sizeof(Record_Commands_Job_Data),
+                .alignment = alignof(Record_Commands_Job_Data)
+            },
+            .proc = &record_render_graph_node_commands_job,
+            .priority = Job_Priority::HIGH,
+            .name = "record_render_graph_node_commands"
         };
 
-        if (renderer_state->multithreaded_rendering)
-        {
-            Job_Data job_data =
-            {
-                .parameters = job_parameters,
-                .proc = &record_render_graph_node_commands_job
-            };
-            node.job_handle = execute_job(job_data);
-        }
-        else
+        // each job only writes its own node's command list, transitions and submission happen in render.
+        add_task(task_graph, job_data);
+    }
+}
+
+void render(Render_Graph *render_graph, Renderer *renderer, Renderer_State *renderer_state)
+{
+    U32 frame_index = renderer_state->current_frame_in_flight_index;
+
+    auto &sorted_nodes = render_graph->topologically_sorted_nodes;
+
+    Task_Graph *task_graph = &render_graph->record_commands_task_graph;
+    HE_ASSERT(task_graph->tasks.count == sorted_nodes.count);
+
+    if (renderer_state->multithreaded_rendering)
+    {
+        execute_task_graph(task_graph);
+    }
+    else
+    {
+        for (const Task &task : task_graph->tasks)
         {
-            record_render_graph_node_commands_job(job_parameters);
-            node.job_handle = Resource_Pool< Job >::invalid_handle;
+            record_render_graph_node_commands_job(task.job_data.parameters);
         }
     }
 
-    for (Render_Graph_Node_Handle node_handle : sorted_nodes)
+    for (U32 node_index = 0; node_index < sorted_nodes.count; node_index++)
     {
+        Render_Graph_Node_Handle node_handle = sorted_nodes[node_index];
         Render_Graph_Node &node = render_graph->nodes[node_handle];
-        wait_for_job_to_finish(node.job_handle);
+
+        if (renderer_state->multithreaded_rendering)
+        {
+            wait_for_task(task_graph, node_index);
+        }
 
         Counted_Array< Clear_Value, HE_MAX_ATTACHMENT_COUNT > clear_values = {};
 
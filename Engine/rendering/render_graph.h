@@ -108,7 +108,6 @@ struct Render_Graph_Node
     Render_Pass_Handle render_pass;
     Frame_Buffer_Handle frame_buffers[HE_MAX_FRAMES_IN_FLIGHT];
 
-    Job_Handle job_handle;
     Command_List command_list;
 };
 
@@ -124,10 +123,14 @@ struct Render_Graph
     Counted_Array< Render_Graph_Node_Handle, HE_MAX_RENDER_GRAPH_NODE_COUNT > node_stack;
     Counted_Array< Render_Graph_Node_Handle, HE_MAX_RENDER_GRAPH_NODE_COUNT > topologically_sorted_nodes;
 
+    // records the commands of every sorted node, rebuilt by compile.
+    Task_Graph record_commands_task_graph;
+
     Render_Graph_Resource *presentable_resource;
 };
 
 void init(Render_Graph *render_graph);
+void deinit(Render_Graph *render_graph);
 
 Render_Graph_Node& add_graphics_node(Render_Graph *render_graph, const char *name, Execute_Render_Graph_Node_Proc execute);
 Render_Graph_Node& add_compute_node(Render_Graph *render_graph, const char *name, Execute_Render_Graph_Node_Proc execute);
@@ -117,6 +117,9 @@ bool request_renderer(RenderingAPI rendering_api, Renderer *renderer)
 
 bool init_renderer_state(Engine *engine)
 {
+    Memory_Tag previous_memory_tag = set_thread_memory_tag(Memory_Tag::RENDERER);
+    HE_DEFER { set_thread_memory_tag(previous_memory_tag); };
+
     Memory_Context memory_context = grab_memory_context();
 
     renderer_state = HE_ALLOCATOR_ALLOCATE(memory_context.permenent_allocator, Renderer_State);
@@ -134,21 +137,21 @@ bool init_renderer_state(Engine *engine)
     bool render_commands_mutex_created = platform_create_mutex(&renderer_state->render_commands_mutex);
     HE_ASSERT(render_commands_mutex_created);
     
-    init(&renderer_state->buffers, HE_MAX_BUFFER_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->textures, HE_MAX_TEXTURE_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->samplers, HE_MAX_SAMPLER_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->shaders, HE_MAX_SHADER_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->pipeline_states, HE_MAX_PIPELINE_STATE_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->bind_groups, HE_MAX_BIND_GROUP_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->render_passes, HE_MAX_RENDER_PASS_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->frame_buffers, HE_MAX_FRAME_BUFFER_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->semaphores, HE_MAX_SEMAPHORE_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->materials, HE_MAX_MATERIAL_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->static_meshes, HE_MAX_STATIC_MESH_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->scenes, HE_MAX_SCENE_COUNT, memory_context.permenent_allocator);
-    init(&renderer_state->upload_requests, HE_MAX_UPLOAD_REQUEST_COUNT, memory_context.permenent_allocator);
-
-    platform_create_mutex(&renderer_state->pending_upload_requests_mutex);
+    init(&renderer_state->buffers, HE_MAX_BUFFER_COUNT);
+    init(&renderer_state->textures, HE_MAX_TEXTURE_COUNT);
+    init(&renderer_state->samplers, HE_MAX_SAMPLER_COUNT);
+    init(&renderer_state->shaders, HE_MAX_SHADER_COUNT);
+    init(&renderer_state->pipeline_states, HE_MAX_PIPELINE_STATE_COUNT);
+    init(&renderer_state->bind_groups, HE_MAX_BIND_GROUP_COUNT);
+    init(&renderer_state->render_passes, HE_MAX_RENDER_PASS_COUNT);
+    init(&renderer_state->frame_buffers, HE_MAX_FRAME_BUFFER_COUNT);
+    init(&renderer_state->semaphores, HE_MAX_SEMAPHORE_COUNT);
+    init(&renderer_state->materials, HE_MAX_MATERIAL_COUNT);
+    init(&renderer_state->static_meshes, HE_MAX_STATIC_MESH_COUNT);
+    init(&renderer_state->scenes, HE_MAX_SCENE_COUNT);
+    init(&renderer_state->upload_requests, HE_MAX_UPLOAD_REQUEST_COUNT);
+
+    init(&renderer_state->submitted_upload_requests, HE_MAX_UPLOAD_REQUEST_COUNT, memory_context.permenent_allocator);
     reset(&renderer_state->pending_upload_requests);
 
     U32 &back_buffer_width = renderer_state->back_buffer_width;
@@ -394,17 +397,26 @@ bool init_renderer_state(Engine *engine)
         renderer_state->default_material = renderer_create_material(default_material_descriptor);
         HE_ASSERT(is_valid_handle(&renderer_state->materials, renderer_state->default_material));
 
-        set_property(renderer_state->default_material, HE_STRING_LITERAL("debug_texture_index"), { .u32 = (U32)renderer_state->white_pixel_texture.index });
-        set_property(renderer_state->default_material, HE_STRING_LITERAL("debug_color"), { .v3f = { 1.0f, 0.0f, 1.0f }});
+        set_property(renderer_state->default_material, HE_NAME("debug_texture_index"), { .u32 = (U32)renderer_state->white_pixel_texture.index });
+        set_property(renderer_state->default_material, HE_NAME("debug_color"), { .v3f = { 1.0f, 0.0f, 1.0f }});
 
         Shader *default_shader = get(&renderer_state->shaders, renderer_state->default_shader);
 
         Frame_Render_Data *render_data = &renderer_state->render_data;
-        // init(&render_data->skybox_commands);
-        // init(&render_data->opaque_commands);
-        // init(&render_data->alpha_cutoff_commands);
-        // init(&render_data->transparent_commands);
-        // init(&render_data->outline_commands);
+        Virtual_Array< Draw_Command > *draw_command_lists[] =
+        {
+            &render_data->skybox_commands,
+            &render_data->opaque_commands,
+            &render_data->alpha_cutoff_commands,
+            &render_data->transparent_commands,
+            &render_data->outline_commands
+        };
+
+        for (Virtual_Array< Draw_Command > *draw_command_list : draw_command_lists)
+        {
+            bool draw_commands_reserved = init(draw_command_list, HE_MAX_DRAW_COMMAND_COUNT);
+            HE_ASSERT(draw_commands_reserved);
+        }
 
         render_data->light_bin_count = HE_LIGHT_BIN_COUNT;
 
@@ -607,13 +619,13 @@ bool init_renderer_state(Engine *engine)
         glm::vec3 outline_color = { 1.0f, 1.0f, 0.2f };
 
         renderer_state->outline_first_pass = renderer_create_material(first_pass_outline_material);
-        set_property(renderer_state->outline_first_pass, HE_STRING_LITERAL("scale_factor"), { .f32 = 1.0f });
-        set_property(renderer_state->outline_first_pass, HE_STRING_LITERAL("outline_color"), { .v3f = outline_color });
+        set_property(renderer_state->outline_first_pass, HE_NAME("scale_factor"), { .f32 = 1.0f });
+        set_property(renderer_state->outline_first_pass, HE_NAME("outline_color"), { .v3f = outline_color });
 
         renderer_state->outline_second_pass = renderer_create_material(second_pass_outline_material);
 
-        set_property(renderer_state->outline_second_pass, HE_STRING_LITERAL("scale_factor"), { .f32 = 1.01f });
-        set_property(renderer_state->outline_second_pass, HE_STRING_LITERAL("outline_color"), { .v3f = outline_color });
+        set_property(renderer_state->outline_second_pass, HE_NAME("scale_factor"), { .f32 = 1.01f });
+        set_property(renderer_state->outline_second_pass, HE_NAME("outline_color"), { .v3f = outline_color });
     }
 
     {
@@ -762,6 +774,8 @@ void deinit_renderer_state()
 {
     renderer->wait_for_gpu_to_finish_all_work();
 
+    deinit(&renderer_state->render_graph);
+
     for (auto it = iterator(&renderer_state->buffers); next(&renderer_state->buffers, it);)
     {
         renderer->destroy_buffer(it, true);
@@ -802,6 +816,13 @@ void deinit_renderer_state()
         renderer->destroy_semaphore(it);
     }
 
+    Frame_Render_Data *render_data = &renderer_state->render_data;
+    deinit(&render_data->skybox_commands);
+    deinit(&render_data->opaque_commands);
+    deinit(&render_data->alpha_cutoff_commands);
+    deinit(&render_data->transparent_commands);
+    deinit(&render_data->outline_commands);
+
     renderer->deinit();
 
     platform_shutdown_imgui();
@@ -835,10 +856,39 @@ void renderer_wait_for_gpu_to_finish_all_work()
     renderer->wait_for_gpu_to_finish_all_work();
 }
 
+void renderer_trim_resource_pools()
+{
+    // trimming must not race a thread reading the slots of a handle it didn't check.
+    wait_for_all_jobs_to_finish();
+    renderer->wait_for_gpu_to_finish_all_work();
+
+    trim(&renderer_state->buffers);
+    trim(&renderer_state->textures);
+    trim(&renderer_state->bind_groups);
+    trim(&renderer_state->materials);
+    trim(&renderer_state->static_meshes);
+}
+
 //
 // Buffers
 //
 
+// gpu memory counts against the budgets of the assets that own it.
+static Memory_Tag get_buffer_memory_tag(Buffer_Usage usage)
+{
+    if (usage == Buffer_Usage::VERTEX || usage == Buffer_Usage::INDEX)
+    {
+        return Memory_Tag::MESHES;
+    }
+
+    return Memory_Tag::RENDERER;
+}
+
+static Memory_Tag get_texture_memory_tag(const Texture *texture)
+{
+    return texture->is_attachment ? Memory_Tag::RENDERER : Memory_Tag::TEXTURES;
+}
+
 Buffer_Handle renderer_create_buffer(const Buffer_Descriptor &descriptor)
 {
     Buffer_Handle buffer_handle = acquire_handle(&renderer_state->buffers);
@@ -850,6 +900,8 @@ Buffer_Handle renderer_create_buffer(const Buffer_Descriptor &descriptor)
     buffer->usage = descriptor.usage;
     buffer->size = descriptor.size;
 
+    record_external_allocation(get_buffer_memory_tag(buffer->usage), buffer->size);
+
     return buffer_handle;
 }
 
@@ -860,6 +912,9 @@ Buffer* renderer_get_buffer(Buffer_Handle buffer_handle)
 
 void renderer_destroy_buffer(Buffer_Handle &buffer_handle)
 {
+    Buffer *buffer = get(&renderer_state->buffers, buffer_handle);
+    record_external_deallocation(get_buffer_memory_tag(buffer->usage), buffer->size);
+
     renderer->destroy_buffer(buffer_handle, false);
     release_handle(&renderer_state->buffers, buffer_handle);
     buffer_handle = Resource_Pool< Buffer >::invalid_handle;
@@ -919,6 +974,8 @@ Texture_Handle renderer_create_texture(const Texture_Descriptor &descriptor)
     texture->sample_count = descriptor.sample_count;
     texture->is_storage = descriptor.is_storage;
 
+    record_external_allocation(get_texture_memory_tag(texture), texture->size);
+
     return texture_handle;
 }
 
@@ -940,6 +997,8 @@ void renderer_destroy_texture(Texture_Handle &texture_handle)
         HE_ALLOCATOR_DEALLOCATE(memory_context.general_allocator, (void *)texture->name.data);
     }
 
+    record_external_deallocation(get_texture_memory_tag(texture), texture->size);
+
     texture->width = 0;
     texture->height = 0;
     texture->sample_count = 1;
@@ -1706,6 +1765,7 @@ Material_Handle renderer_create_material(const Material_Descriptor &descriptor)
 
         Material_Property *property = &material->properties[property_index];
         property->name = member->name;
+        property->interned_name = make_name(member->name);
         property->data_type = member->data_type;
         property->offset_in_buffer = member->offset;
 
@@ -1764,13 +1824,13 @@ void renderer_destroy_material(Material_Handle &material_handle)
     material_handle = Resource_Pool< Material >::invalid_handle;
 }
 
-S32 find_property(Material_Handle material_handle, String name)
+S32 find_property(Material_Handle material_handle, Name name)
 {
     Material *material = get(&renderer_state->materials, material_handle);
     for (U32 property_index = 0; property_index < material->properties.count; property_index++)
     {
         Material_Property *property = &material->properties[property_index];
-        if (property->name == name)
+        if (property->interned_name == name)
         {
             return (S32)property_index;
         }
@@ -1779,12 +1839,35 @@ S32 find_property(Material_Handle material_handle, String name)
     return -1;
 }
 
+S32 find_property(Material_Handle material_handle, String name)
+{
+    // every property name is interned when the material is created so a name that was never interned can't match.
+    Name interned_name = find_name(name);
+    if (interned_name == Name {})
+    {
+        return -1;
+    }
+    return find_property(material_handle, interned_name);
+}
+
+bool set_property(Material_Handle material_handle, Name name, Material_Property_Data data)
+{
+    S32 property_id = find_property(material_handle, name);
+    if (property_id == -1)
+    {
+        String str = name_to_string(name);
+        HE_LOG(Rendering, Trace, "can't find material property: %.*s\n", HE_EXPAND_STRING(str));
+        return false;
+    }
+    return set_property(material_handle, property_id, data);
+}
+
 bool set_property(Material_Handle material_handle, String name, Material_Property_Data data)
 {
     S32 property_id = find_property(material_handle, name);
     if (property_id == -1)
     {
-        HE_LOG(Rendering, Trace, "can't find material property: %s\n", name);
+        HE_LOG(Rendering, Trace, "can't find material property: %.*s\n", HE_EXPAND_STRING(name));
         return false;
     }
     return set_property(material_handle, property_id, data);
@@ -2228,7 +2311,9 @@ Scene_Handle renderer_create_scene(U32 node_capacity)
 {
     Scene_Handle scene_handle = acquire_handle(&renderer_state->scenes);
     Scene *scene = get(&renderer_state->scenes, scene_handle);
-    // init(&scene->nodes, 0, node_capacity);
+    bool nodes_reserved = init(&scene->nodes, HE_MAX_SCENE_NODE_COUNT);
+    HE_ASSERT(nodes_reserved);
+    set_capacity(&scene->nodes, HE_MIN(node_capacity, (U32)HE_MAX_SCENE_NODE_COUNT));
     scene->node_count = 0;
     scene->first_free_node_index = -1;
     Skybox *skybox = &scene->skybox;
@@ -2420,7 +2505,7 @@ U32 allocate_node(Scene *scene, String name)
     }
 
     Scene_Node *node = get_node(scene, node_index);
-    node->name = copy_string(name, memory_context.general_allocator);
+    node->name = copy_string(name, memory_context.slab_allocator);
 
     node->parent_index = -1;
     node->first_child_index = -1;
@@ -2550,7 +2635,7 @@ void remove_node(Scene *scene, U32 node_index)
         remove_child(scene, node->parent_index, node_index);
     }
 
-    HE_ALLOCATOR_DEALLOCATE(memory_context.general_allocator, (void *)node->name.data);
+    HE_ALLOCATOR_DEALLOCATE(memory_context.slab_allocator, (void *)node->name.data);
 
     if (scene->first_free_node_index == -1)
     {
@@ -2610,7 +2695,7 @@ static void traverse_scene_tree(Scene *scene, U32 node_index, Transform parent_t
 
                     Material *material = renderer_get_material(material_handle);
 
-                    Dynamic_Array< Draw_Command > *command_list = nullptr;
+                    Virtual_Array< Draw_Command > *command_list = nullptr;
 
                     switch (material->type)
                     {
@@ -2638,7 +2723,7 @@ static void traverse_scene_tree(Scene *scene, U32 node_index, Transform parent_t
 
                     if (node_index == render_data->selected_node_index)
                     {
-                        Dynamic_Array< Draw_Command > *outlines = &render_data->outline_commands;
+                        Virtual_Array< Draw_Command > *outlines = &render_data->outline_commands;
                         Draw_Command &draw_command = append(outlines);
                         draw_command.static_mesh = static_mesh_handle;
                         draw_command.sub_mesh_index = sub_mesh_index;
@@ -2740,9 +2825,9 @@ Upload_Request *renderer_get_upload_request(Upload_Request_Handle upload_request
 
 void renderer_add_pending_upload_request(Upload_Request_Handle upload_request_handle)
 {
-    platform_lock_mutex(&renderer_state->pending_upload_requests_mutex);
-    append(&renderer_state->pending_upload_requests, upload_request_handle);
-    platform_unlock_mutex(&renderer_state->pending_upload_requests_mutex);
+    // never full, the queue has a cell for every upload request.
+    bool pushed = push(&renderer_state->submitted_upload_requests, upload_request_handle);
+    HE_ASSERT(pushed);
 }
 
 void renderer_destroy_upload_request(Upload_Request_Handle upload_request_handle)
@@ -2766,7 +2851,11 @@ void renderer_destroy_upload_request(Upload_Request_Handle upload_request_handle
 
 void renderer_handle_upload_requests()
 {
-    platform_lock_mutex(&renderer_state->pending_upload_requests_mutex);
+    Upload_Request_Handle submitted_upload_request_handle;
+    while (pop(&renderer_state->submitted_upload_requests, &submitted_upload_request_handle))
+    {
+        append(&renderer_state->pending_upload_requests, submitted_upload_request_handle);
+    }
 
     for (S32 index = 0; index < (S32)renderer_state->pending_upload_requests.count; index++)
     {
@@ -2789,8 +2878,6 @@ void renderer_handle_upload_requests()
             index--;
         }
     }
-
-    platform_unlock_mutex(&renderer_state->pending_upload_requests_mutex);
 }
 
 Render_Context get_render_context()
@@ -2886,6 +2973,7 @@ void begin_rendering(const Camera *camera)
     Memory_Context memory_context = grab_memory_context();
 
     renderer->begin_frame();
+    begin_frame_memory(renderer_state->frames_in_flight);
 
     U32 frame_index = renderer_state->current_frame_in_flight_index;
 
@@ -2980,14 +3068,33 @@ void begin_rendering(const Camera *camera)
     reset(&render_data->outline_commands);
     reset(&render_data->lights);
 
-    U32 texture_count = renderer_state->textures.capacity;
+    U32 texture_count = renderer_state->textures.capacity.load(std::memory_order_acquire);
     Texture_Handle *textures = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, Texture_Handle, texture_count);
     Sampler_Handle *samplers = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, Sampler_Handle, texture_count);
 
-    platform_lock_mutex(&renderer_state->textures.mutex);
+    // free slots are never visited by next() below and a zeroed handle is not a valid handle.
+    for (U32 texture_index = 0; texture_index < texture_count; texture_index++)
+    {
+        textures[texture_index] = renderer_state->white_pixel_texture;
+        samplers[texture_index] = renderer_state->default_texture_sampler;
+    }
 
+    // loading jobs can create and destroy textures while this runs, textures past the count taken above are
+    // bound next frame and a texture destroyed after next() returned it is bound as the white pixel texture.
     for (auto it = iterator(&renderer_state->textures); next(&renderer_state->textures, it);)
     {
+        if ((U32)it.index >= texture_count)
+        {
+            break;
+        }
+
+        if (!is_valid_handle(&renderer_state->textures, it))
+        {
+            textures[it.index] = renderer_state->white_pixel_texture;
+            samplers[it.index] = renderer_state->default_texture_sampler;
+            continue;
+        }
+
         Texture *texture = get(&renderer_state->textures, it);
 
         if (texture->is_attachment || !texture->is_uploaded_to_gpu || texture->is_storage)
@@ -3002,8 +3109,6 @@ void begin_rendering(const Camera *camera)
         samplers[it.index] = texture->is_cubemap ? renderer_state->default_cubemap_sampler : renderer_state->default_texture_sampler;
     }
 
-    platform_unlock_mutex(&renderer_state->textures.mutex);
-
     Update_Binding_Descriptor update_globals_bindings[] =
     {
         {
@@ -3132,50 +3237,49 @@ static bool calc_light_aabb(Shader_Light *light, const glm::vec3 &view_p, Frame_
     return true;
 }
 
-void end_rendering()
+struct Sorted_Light
 {
-    Memory_Context memory_context = grab_memory_context();
+    F32 depth;
+    F32 min_depth;
+    F32 max_depth;
+    U16 index;
+};
 
-    Frame_Render_Data *render_data = &renderer_state->render_data;
+struct Cull_Lights_Job_Data
+{
+    Frame_Render_Data *render_data;
+    Sorted_Light *sorted_lights;
+    bool *is_light_visible;
+};
+
+static void cull_lights(const Parallel_For_Parameters &params)
+{
+    Cull_Lights_Job_Data *job_data = (Cull_Lights_Job_Data *)params.data;
+    Frame_Render_Data *render_data = job_data->render_data;
 
     U32 width = renderer_state->back_buffer_width;
     U32 height = renderer_state->back_buffer_height;
 
-    U32 total_light_count = render_data->globals->light_count;
-    U32 light_count = render_data->globals->light_count;
-    Shader_Light *lights = render_data->lights.data;
-
-    struct Sorted_Light
-    {
-        F32 depth;
-        F32 min_depth;
-        F32 max_depth;
-        U16 index;
-    };
-
-    U32 sorted_light_count = 0;
-    Sorted_Light *sorted_lights = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, Sorted_Light, light_count + 1);
-
     F32 one_over_render_dist = 1.0f / (render_data->far_z - render_data->near_z);
-    U32 directional_light_count = 0;
 
-    for (U32 light_index = 0; light_index < light_count; light_index++)
+    for (U32 light_index = params.begin; light_index < params.end; light_index++)
     {
-        Shader_Light *light = &lights[light_index];
+        Shader_Light *light = &render_data->lights[light_index];
         glm::vec3 *light_position = (glm::vec3 *)light->position;
         glm::uvec2 *light_screen_aabb = (glm::uvec2 *)light->screen_aabb;
 
-        Sorted_Light *sorted_light = &sorted_lights[sorted_light_count];
+        Sorted_Light *sorted_light = &job_data->sorted_lights[light_index];
         sorted_light->index = light_index;
 
+        job_data->is_light_visible[light_index] = false;
+
         if (light->type == (U32)Light_Type::DIRECTIONAL)
         {
             *light_screen_aabb = { 0, (width - 1) | ((height - 1) << 16) };
             sorted_light->depth = -HE_MAX_F32;
             sorted_light->min_depth = 0.0f;
             sorted_light->max_depth = 1.0f;
-            directional_light_count++;
-            sorted_light_count++;
+            job_data->is_light_visible[light_index] = true;
             continue;
         }
 
@@ -3198,7 +3302,49 @@ void end_rendering()
         sorted_light->depth = depth;
         sorted_light->min_depth = min_depth;
         sorted_light->max_depth = max_depth;
-        sorted_light_count++;
+        job_data->is_light_visible[light_index] = true;
+    }
+}
+
+void end_rendering()
+{
+    Memory_Context memory_context = grab_memory_context();
+
+    Frame_Render_Data *render_data = &renderer_state->render_data;
+
+    U32 total_light_count = render_data->globals->light_count;
+    U32 light_count = render_data->globals->light_count;
+    Shader_Light *lights = render_data->lights.data;
+
+    Sorted_Light *sorted_lights = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, Sorted_Light, light_count + 1);
+    bool *is_light_visible = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.temp_allocator, bool, light_count + 1);
+
+    Cull_Lights_Job_Data cull_lights_job_data =
+    {
+        .render_data = render_data,
+        .sorted_lights = sorted_lights,
+        .is_light_visible = is_light_visible
+    };
+
+    parallel_for(0, light_count, 64, &cull_lights, &cull_lights_job_data);
+
+    // compact in place, directional lights keep their place in front after sorting since their depth is -HE_MAX_F32.
+    U32 sorted_light_count = 0;
+    U32 directional_light_count = 0;
+
+    for (U32 light_index = 0; light_index < light_count; light_index++)
+    {
+        if (!is_light_visible[light_index])
+        {
+            continue;
+        }
+
+        if (lights[light_index].type == (U32)Light_Type::DIRECTIONAL)
+        {
+            directional_light_count++;
+        }
+
+        sorted_lights[sorted_light_count++] = sorted_lights[light_index];
     }
 
     light_count = sorted_light_count;
@@ -4,27 +4,32 @@
 #include "core/platform.h"
 #include "core/job_system.h"
 
+#include "containers/queue.h"
+
 #include "rendering/renderer_types.h"
 #include "rendering/camera.h"
 #include "rendering/render_graph.h"
 
 #include <atomic>
 
-#define HE_MAX_BUFFER_COUNT 4096
-#define HE_MAX_TEXTURE_COUNT 4096
+// the resource pools reserve address space for these counts and commit it as they grow.
+#define HE_MAX_BUFFER_COUNT (256 * 1024)
+#define HE_MAX_TEXTURE_COUNT HE_MAX_BINDLESS_RESOURCE_DESCRIPTOR_COUNT
 #define HE_MAX_SAMPLER_COUNT 4096
-#define HE_MAX_MATERIAL_COUNT 4096
+#define HE_MAX_MATERIAL_COUNT (64 * 1024)
 #define HE_MAX_RENDER_PASS_COUNT 4096
 #define HE_MAX_FRAME_BUFFER_COUNT 4096
-#define HE_MAX_STATIC_MESH_COUNT 4096
+#define HE_MAX_STATIC_MESH_COUNT (64 * 1024)
 #define HE_MAX_SHADER_COUNT 4096
 #define HE_MAX_SHADER_GROUP_COUNT 4096
 #define HE_MAX_PIPELINE_STATE_COUNT 4096
 #define HE_MAX_BIND_GROUP_LAYOUT_COUNT 4096
-#define HE_MAX_BIND_GROUP_COUNT 4096
+#define HE_MAX_BIND_GROUP_COUNT (256 * 1024)
 #define HE_MAX_SEMAPHORE_COUNT 4096
 #define HE_MAX_SCENE_COUNT 4096
+#define HE_MAX_SCENE_NODE_COUNT (1024 * 1024)
 #define HE_MAX_UPLOAD_REQUEST_COUNT 4096
+#define HE_MAX_DRAW_COMMAND_COUNT (1024 * 1024)
 
 #define HE_MAX_LIGHT_COUNT 512
 #define HE_LIGHT_BIN_COUNT 32
@@ -144,11 +149,11 @@ struct Frame_Render_Data
     Material_Handle current_material_handle;
     Static_Mesh_Handle current_static_mesh_handle;
 
-    Dynamic_Array< Draw_Command > skybox_commands;
-    Dynamic_Array< Draw_Command > opaque_commands;
-    Dynamic_Array< Draw_Command > alpha_cutoff_commands;
-    Dynamic_Array< Draw_Command > transparent_commands;
-    Dynamic_Array< Draw_Command > outline_commands;
+    Virtual_Array< Draw_Command > skybox_commands;
+    Virtual_Array< Draw_Command > opaque_commands;
+    Virtual_Array< Draw_Command > alpha_cutoff_commands;
+    Virtual_Array< Draw_Command > transparent_commands;
+    Virtual_Array< Draw_Command > outline_commands;
 
     S32 selected_node_index;
 
@@ -181,7 +186,8 @@ struct Renderer_State
     Resource_Pool< Scene > scenes;
     Resource_Pool< Upload_Request > upload_requests;
 
-    Mutex pending_upload_requests_mutex;
+    // loading jobs submit upload requests here and renderer_handle_upload_requests moves them to pending_upload_requests.
+    MPMC_Queue< Upload_Request_Handle > submitted_upload_requests;
     Counted_Array< Upload_Request_Handle, HE_MAX_UPLOAD_REQUEST_COUNT > pending_upload_requests;
     
     F32 gamma;
@@ -254,6 +260,9 @@ void deinit_renderer_state();
 void renderer_on_resize(U32 width, U32 height);
 void renderer_wait_for_gpu_to_finish_all_work();
 
+// gives back the pool pages that unloading emptied, waits for every job and the gpu so call it at a quiet point like a level change.
+void renderer_trim_resource_pools();
+
 //
 // Buffers
 //
@@ -355,7 +364,9 @@ void renderer_use_material(Material_Handle material_handle, Material_Handle *las
 Material* renderer_get_material(Material_Handle material_handle);
 void renderer_destroy_material(Material_Handle &material_handle);
 
+S32 find_property(Material_Handle material_handle, Name name);
 S32 find_property(Material_Handle material_handle, String name);
+bool set_property(Material_Handle material_handle, Name name, Material_Property_Data data);
 bool set_property(Material_Handle material_handle, String name, Material_Property_Data data);
 bool set_property(Material_Handle material_handle, S32 property_id, Material_Property_Data data);
 
@@ -4,8 +4,10 @@
 #include "containers/array.h"
 #include "containers/counted_array.h"
 #include "containers/dynamic_array.h"
+#include "containers/virtual_array.h"
 #include "containers/string.h"
 #include "containers/resource_pool.h"
+#include "core/name.h"
 
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
@@ -557,6 +559,7 @@ union Material_Property_Data
 struct Material_Property
 {
     String name;
+    Name interned_name;
 
     Shader_Data_Type data_type;
     Material_Property_Data data;
@@ -724,7 +727,7 @@ struct Scene
 {
     Skybox skybox;
     U32 node_count;
-    Dynamic_Array< Scene_Node > nodes;
+    Virtual_Array< Scene_Node > nodes; // node pointers stay valid while the scene grows.
     S32 first_free_node_index;
 };
 
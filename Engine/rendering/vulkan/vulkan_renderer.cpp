@@ -238,6 +238,37 @@ void destroy_descriptor_pool_allocator(Vulkan_Descriptor_Pool_Allocator *allocat
     deinit(&allocator->full_pools);
 }
 
+template< typename T >
+static bool commit_resource_array(U32 first_index, U32 slot_count, void *user_data)
+{
+    return commit_os_pages(user_data, sizeof(T) * first_index, sizeof(T) * slot_count);
+}
+
+// indexed by the handles of a renderer pool, reserves the range for the pool's max capacity and commits it as the pool grows.
+template< typename T, typename Resource_Type >
+static T* allocate_resource_array(Resource_Pool< Resource_Type > *resource_pool)
+{
+    void *memory = platform_reserve_memory(align_to_os_page(sizeof(T) * resource_pool->max_capacity));
+    HE_ASSERT(memory);
+
+    bool commited = set_on_grow(resource_pool, &commit_resource_array< T >, memory);
+    HE_ASSERT(commited);
+    return (T *)memory;
+}
+
+// a pending delete list is destroyed within frames_in_flight frames of its first append, so it lives in frame memory
+// grabbed one frame ahead and is rebound each time it starts empty.
+template< typename T >
+static void defer_delete(Dynamic_Array< T > *pending_deletes, const T &resource)
+{
+    if (!pending_deletes->count)
+    {
+        *pending_deletes = make_dynamic_array< T >(grab_frame_memory(1));
+    }
+
+    append(pending_deletes, resource);
+}
+
 static bool init_vulkan(Vulkan_Context *context, Engine *engine, Renderer_State *renderer_state)
 {
     Memory_Context memory_context = grab_memory_context();
@@ -252,16 +283,16 @@ static bool init_vulkan(Vulkan_Context *context, Engine *engine, Renderer_State
     allocation_callbacks->pfnInternalAllocation = nullptr;
     allocation_callbacks->pfnInternalFree = nullptr;
 
-    context->buffers = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Buffer, HE_MAX_BUFFER_COUNT);
-    context->textures = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Image, HE_MAX_TEXTURE_COUNT);
-    context->samplers = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Sampler, HE_MAX_SAMPLER_COUNT);
-    context->shaders = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Shader, HE_MAX_SHADER_COUNT);
-    context->pipeline_states = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Pipeline_State, HE_MAX_PIPELINE_STATE_COUNT);
-    context->bind_groups = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Bind_Group, HE_MAX_BIND_GROUP_COUNT);
-    context->render_passes = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Render_Pass, HE_MAX_RENDER_PASS_COUNT);
-    context->frame_buffers = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Frame_Buffer, HE_MAX_FRAME_BUFFER_COUNT);
-    context->semaphores = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Semaphore, HE_MAX_SEMAPHORE_COUNT);
-    context->upload_requests = HE_ALLOCATOR_ALLOCATE_ARRAY(memory_context.permenent_allocator, Vulkan_Upload_Request, HE_MAX_UPLOAD_REQUEST_COUNT);
+    context->buffers = allocate_resource_array< Vulkan_Buffer >(&renderer_state->buffers);
+    context->textures = allocate_resource_array< Vulkan_Image >(&renderer_state->textures);
+    context->samplers = allocate_resource_array< Vulkan_Sampler >(&renderer_state->samplers);
+    context->shaders = allocate_resource_array< Vulkan_Shader >(&renderer_state->shaders);
+    context->pipeline_states = allocate_resource_array< Vulkan_Pipeline_State >(&renderer_state->pipeline_states);
+    context->bind_groups = allocate_resource_array< Vulkan_Bind_Group >(&renderer_state->bind_groups);
+    context->render_passes = allocate_resource_array< Vulkan_Render_Pass >(&renderer_state->render_passes);
+    context->frame_buffers = allocate_resource_array< Vulkan_Frame_Buffer >(&renderer_state->frame_buffers);
+    context->semaphores = allocate_resource_array< Vulkan_Semaphore >(&renderer_state->semaphores);
+    context->upload_requests = allocate_resource_array< Vulkan_Upload_Request >(&renderer_state->upload_requests);
 
     const char *required_instance_extensions[] =
     {
@@ -596,30 +627,10 @@ static bool init_vulkan(Vulkan_Context *context, Engine *engine, Renderer_State
 
     HE_CHECK_VKRESULT(vkCreatePipelineCache(context->logical_device, &pipeline_cache_create_info, &context->allocation_callbacks, &context->pipeline_cache));
 
-    init(&context->thread_states, get_effective_thread_count(),  memory_context.permenent_allocator);
-    
-    S32 slot_index = insert(&context->thread_states, platform_get_current_thread_id());
-    HE_ASSERT(slot_index != -1);
-    Vulkan_Thread_State *main_thread_state = &context->thread_states.values[slot_index];
-
-    VkCommandPoolCreateInfo graphics_command_pool_create_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
-    graphics_command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    graphics_command_pool_create_info.queueFamilyIndex = context->graphics_queue_family_index;
-    HE_CHECK_VKRESULT(vkCreateCommandPool(context->logical_device, &graphics_command_pool_create_info, &context->allocation_callbacks, &main_thread_state->graphics_command_pool));
-
-    VkCommandPoolCreateInfo compute_command_pool_create_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
-    compute_command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    compute_command_pool_create_info.queueFamilyIndex = context->compute_queue_family_index;
-    HE_CHECK_VKRESULT(vkCreateCommandPool(context->logical_device, &compute_command_pool_create_info, &context->allocation_callbacks, &main_thread_state->compute_command_pool));
-
+    Vulkan_Thread_State *main_thread_state = get_thread_state(context);
     context->graphics_command_pool = main_thread_state->graphics_command_pool;
     context->compute_command_pool = main_thread_state->compute_command_pool;
 
-    VkCommandPoolCreateInfo transfer_command_pool_create_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
-    transfer_command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    transfer_command_pool_create_info.queueFamilyIndex = context->transfer_queue_family_index;
-    HE_CHECK_VKRESULT(vkCreateCommandPool(context->logical_device, &transfer_command_pool_create_info, &context->allocation_callbacks, &main_thread_state->transfer_command_pool));
-
     VkCommandBufferAllocateInfo graphics_command_buffer_allocate_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
     graphics_command_buffer_allocate_info.commandPool = main_thread_state->graphics_command_pool;
     graphics_command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -710,13 +721,13 @@ void deinit_vulkan(Vulkan_Context *context)
         vkDestroySemaphore(context->logical_device, context->rendering_finished_semaphores[frame_index], &context->allocation_callbacks);
     }
 
-    for (U32 slot_index = 0; slot_index < context->thread_states.capacity; slot_index++)
+    for (U32 thread_index = 0; thread_index < get_thread_context_count(); thread_index++)
     {
-        if (context->thread_states.states[slot_index] != Slot_State::OCCUPIED)
+        Vulkan_Thread_State *thread_state = &context->thread_states[thread_index];
+        if (thread_state->graphics_command_pool == VK_NULL_HANDLE)
         {
             continue;
         }
-        Vulkan_Thread_State *thread_state = &context->thread_states.values[slot_index];
         vkDestroyCommandPool(context->logical_device, thread_state->graphics_command_pool, &context->allocation_callbacks);
         vkDestroyCommandPool(context->logical_device, thread_state->transfer_command_pool, &context->allocation_callbacks);
         vkDestroyCommandPool(context->logical_device, thread_state->compute_command_pool, &context->allocation_callbacks);
@@ -1632,7 +1643,7 @@ void vulkan_renderer_destroy_texture(Texture_Handle texture_handle, bool immedia
     else
     {
         U32 frame_index = context->renderer_state->current_frame_in_flight_index;
-        append(&context->pending_delete_textures[frame_index], image);
+        defer_delete(&context->pending_delete_textures[frame_index], image);
     }
 }
 
@@ -1728,7 +1739,7 @@ void vulkan_renderer_destroy_sampler(Sampler_Handle sampler_handle, bool immedia
     else
     {
         U32 frame_index = context->renderer_state->current_frame_in_flight_index;
-        append(&context->pending_delete_samplers[frame_index], sampler);
+        defer_delete(&context->pending_delete_samplers[frame_index], sampler);
     }
 }
 
@@ -1750,7 +1761,7 @@ void vulkan_renderer_destroy_shader(Shader_Handle shader_handle, bool immediate)
     else
     {
         U32 frame_index = context->renderer_state->current_frame_in_flight_index;
-        append(&context->pending_delete_shaders[frame_index], shader);
+        defer_delete(&context->pending_delete_shaders[frame_index], shader);
     }
 }
 
@@ -1777,7 +1788,7 @@ void vulkan_renderer_destroy_pipeline_state(Pipeline_State_Handle pipeline_state
     else
     {
         U32 frame_index = context->renderer_state->current_frame_in_flight_index;
-        append(&context->pending_delete_pipeline_states[frame_index], pipeline_state);
+        defer_delete(&context->pending_delete_pipeline_states[frame_index], pipeline_state);
     }
 }
 
@@ -2191,7 +2202,7 @@ void vulkan_renderer_destroy_render_pass(Render_Pass_Handle render_pass_handle,
     else
     {
         U32 frame_index = context->renderer_state->current_frame_in_flight_index;
-        append(&context->pending_delete_render_passes[frame_index], render_pass);
+        defer_delete(&context->pending_delete_render_passes[frame_index], render_pass);
     }
 }
 
@@ -2242,7 +2253,7 @@ void vulkan_renderer_destroy_frame_buffer(Frame_Buffer_Handle frame_buffer_handl
     else
     {
         U32 frame_index = context->renderer_state->current_frame_in_flight_index;
-        append(&context->pending_delete_frame_buffers[frame_index], frame_buffer);
+        defer_delete(&context->pending_delete_frame_buffers[frame_index], frame_buffer);
     }
 }
 
@@ -2363,7 +2374,7 @@ void vulkan_renderer_destroy_buffer(Buffer_Handle buffer_handle, bool immediate)
     else
     {
         U32 frame_index = context->renderer_state->current_frame_in_flight_index;
-        append(&context->pending_delete_buffers[frame_index], vulkan_buffer);
+        defer_delete(&context->pending_delete_buffers[frame_index], vulkan_buffer);
     }
 }
 
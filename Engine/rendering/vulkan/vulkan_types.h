@@ -183,7 +183,7 @@ struct Vulkan_Context
     Counted_Array< Vulkan_Descriptor_Pool_Size_Ratio, HE_MAX_DESCRIPTOR_POOL_SIZE_RATIO_COUNT > descriptor_pool_ratios;
     Vulkan_Descriptor_Pool_Allocator descriptor_pool_allocators[HE_MAX_FRAMES_IN_FLIGHT];
     
-    Hash_Map< U32, Vulkan_Thread_State > thread_states;
+    Vulkan_Thread_State thread_states[HE_MAX_THREAD_CONTEXT_COUNT]; // indexed by Thread_Context::thread_index, created on first use.
 
     VkCommandPool graphics_command_pool;
     VkCommandPool compute_command_pool;
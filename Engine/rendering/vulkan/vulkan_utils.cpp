@@ -393,18 +393,13 @@ void copy_data_to_image(Vulkan_Context *context, Vulkan_Command_Buffer *command_
 
 Vulkan_Thread_State *get_thread_state(Vulkan_Context *context)
 {
-    U32 thread_id = platform_get_current_thread_id();
-    auto it = find(&context->thread_states, thread_id);
-    if (is_valid(it))
+    Thread_Context *thread_context = get_thread_context();
+    Vulkan_Thread_State *thread_state = &context->thread_states[thread_context->thread_index];
+    if (thread_state->graphics_command_pool != VK_NULL_HANDLE)
     {
-        return it.value;
+        return thread_state;
     }
 
-    S32 slot_index = insert(&context->thread_states, thread_id);
-    HE_ASSERT(slot_index != -1);
-
-    Vulkan_Thread_State *thread_state = &context->thread_states.values[slot_index];
-
     VkCommandPoolCreateInfo graphics_command_pool_create_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
     graphics_command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
     graphics_command_pool_create_info.queueFamilyIndex = context->graphics_queue_family_index;
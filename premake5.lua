@@ -50,13 +50,14 @@ project "Engine"
 
     files { "Engine/**.h", "Engine/**.hpp", "Engine/**.cpp", "ThirdParty/ImGuizmo/ImGuizmo.h", "ThirdParty/ImGuizmo/ImGuizmo.cpp" }
 
-    includedirs { "Engine", "ThirdParty", "ThirdParty/ExcaliburHash", "ThirdParty/ExcaliburHash/ExcaliburHash", "ThirdParty/ImGui", "ThirdParty/include" }
+    includedirs { "Engine", "ThirdParty", "ThirdParty/ImGui", "ThirdParty/include" }
     libdirs { "ThirdParty/lib" }
 
     links
     {
         "vulkan-1",
-        "ImGui"
+        "ImGui",
+        "Synchronization"
     }
 
     filter "configurations:Debug"
@@ -111,7 +112,7 @@ project "Editor"
         "Engine"
     }
 
-    includedirs { "Engine", "ThirdParty", "ThirdParty/ImGui", "ThirdParty/ExcaliburHash", "ThirdParty/ExcaliburHash/ExcaliburHash", "ThirdParty/include" }
+    includedirs { "Engine", "ThirdParty", "ThirdParty/ImGui", "ThirdParty/include" }
 
     debugdir "Data"
     targetdir "bin/%{prj.name}"